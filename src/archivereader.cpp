@@ -0,0 +1,132 @@
+#include "archivereader.h"
+
+ArchiveReader::ArchiveReader ()
+	: _archive (""),
+	  _file (NULL),
+	  _unzipped (NULL),
+	  _input (NULL),
+	  _member (NULL)
+{}
+
+ArchiveReader::~ArchiveReader ()
+{
+	Close ();
+}
+
+// test the file's extension, ignoring case
+bool ArchiveReader::IsArchive (wxString path)
+{
+	wxString name = path.Lower ();
+	return name.EndsWith (".zip") || name.EndsWith (".tar") ||
+		name.EndsWith (".tar.gz") || name.EndsWith (".tgz");
+}
+
+bool ArchiveReader::IsZipArchive (wxString path)
+{
+	return path.Lower().EndsWith (".zip");
+}
+
+bool ArchiveReader::IsMemberPath (wxString path)
+{
+	return path.Find ("#zip:") != wxNOT_FOUND || path.Find ("#tar:") != wxNOT_FOUND;
+}
+
+wxString ArchiveReader::GetMemberPath (wxString archive, wxString member)
+{
+	return archive + (IsZipArchive (archive) ? "#zip:" : "#tar:") + member;
+}
+
+bool ArchiveReader::SplitMemberPath (wxString path, wxString & archive, wxString & member)
+{
+	int posn = path.Find ("#zip:");
+	if (posn == wxNOT_FOUND) posn = path.Find ("#tar:");
+	if (posn == wxNOT_FOUND) return false;
+	archive = path.Left (posn);
+	member = path.Mid (posn + 5);
+	return true;
+}
+
+// -- directories are not listed
+bool ArchiveReader::ListMembers (wxString archive, wxArrayString & members)
+{
+	ArchiveReader reader;
+	if (!reader.Open (archive)) return false;
+	wxArchiveEntry * entry;
+	while ((entry = reader._input->GetNextEntry ()) != NULL)
+	{
+		if (!entry->IsDir ()) members.Add (entry->GetName (wxPATH_UNIX));
+		delete entry;
+	}
+	return true;
+}
+
+bool ArchiveReader::Open (wxString archive)
+{
+	Close ();
+	_file = new wxFFileInputStream (archive);
+	if (!_file->IsOk ())
+	{
+		Close ();
+		return false;
+	}
+	_archive = archive;
+	if (IsZipArchive (archive))
+	{
+		_input = new wxZipInputStream (* _file);
+	}
+	else if (archive.Lower().EndsWith (".tar"))
+	{
+		_input = new wxTarInputStream (* _file);
+	}
+	else
+	{
+		_unzipped = new wxZlibInputStream (* _file, wxZLIB_GZIP);
+		_input = new wxTarInputStream (* _unzipped);
+	}
+	return true;
+}
+
+void ArchiveReader::Close ()
+{
+	delete _member;
+	delete _input;
+	delete _unzipped;
+	delete _file;
+	_member = NULL;
+	_input = NULL;
+	_unzipped = NULL;
+	_file = NULL;
+	_archive = "";
+}
+
+// read on through the archive's entries to the member
+bool ArchiveReader::FindMember (wxString member)
+{
+	wxArchiveEntry * entry;
+	while ((entry = _input->GetNextEntry ()) != NULL)
+	{
+		bool found = (entry->GetName (wxPATH_UNIX) == member);
+		delete entry;
+		if (found) return true;
+	}
+	return false;
+}
+
+wxInputStream * ArchiveReader::OpenMember (wxString path)
+{
+	wxString archive;
+	wxString member;
+	if (!SplitMemberPath (path, archive, member)) return NULL;
+	delete _member;
+	_member = NULL;
+	if (archive != _archive && !Open (archive)) return NULL;
+	// -- member may be before the current position, so may need to start again 
+	if (!FindMember (member) && !(Open (archive) && FindMember (member)))
+	{
+		Close ();
+		return NULL;
+	}
+	_member = new wxBufferedInputStream (* _input);
+	return _member;
+}
+
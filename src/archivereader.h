@@ -0,0 +1,53 @@
+#if !defined archivereader_h
+#define archivereader_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <wx/wx.h>
+#include <wx/archive.h>
+#include <wx/stream.h>
+#include <wx/tarstrm.h>
+#include <wx/wfstream.h>
+#include <wx/zipstrm.h>
+#include <wx/zstream.h>
+
+/** ArchiveReader reads the members of zip and tar (optionally gzipped) 
+  * archives, such as submitted batches of work, without unpacking them.
+  * -- a member is named by a path of the form used by wxFileSystem, e.g. 
+  *    "work/smith.zip#zip:essay/part1.txt" or "work/jones.tar.gz#tar:main.c"
+  * -- OpenMember gives a stream positioned at the member's data; the archive
+  *    is kept open, so members read in the order of the archive are found 
+  *    by reading on from the last, and otherwise the archive is reopened
+  */
+class ArchiveReader
+{
+	public:
+		ArchiveReader ();
+		~ArchiveReader ();
+		static bool IsArchive (wxString path);
+		static bool IsMemberPath (wxString path);
+		static wxString GetMemberPath (wxString archive, wxString member);
+		static bool SplitMemberPath (wxString path, wxString & archive, wxString & member);
+		// names of the files within archive, in the archive's order
+		static bool ListMembers (wxString archive, wxArrayString & members);
+		// stream to read the member's data, or NULL if it cannot be found
+		// -- the stream belongs to the ArchiveReader, and is valid until the next call
+		wxInputStream * OpenMember (wxString path);
+		void Close ();
+	private:
+		ArchiveReader (const ArchiveReader &);             // -- not copyable
+		ArchiveReader & operator= (const ArchiveReader &);
+		bool Open (wxString archive);
+		bool FindMember (wxString member);
+		static bool IsZipArchive (wxString path);
+		wxString _archive;
+		wxInputStream * _file;
+		wxInputStream * _unzipped;  // -- for gzipped tar archives
+		wxArchiveInputStream * _input;
+		wxInputStream * _member;    // -- buffers member given out, so characters put 
+		                            //    back by a reader do not pass to the next member
+};
+
+#endif
+
@@ -0,0 +1,318 @@
+#include "binaryio.h"
+
+const size_t BUFFER_SIZE = 1 << 16;
+
+// CRC-32 (as used in zip/png), with the table made on first use
+wxUint32 UpdateCrc32 (wxUint32 crc, const wxUint8 * data, size_t length)
+{
+	static wxUint32 table[256];
+	static bool table_made = false;
+	if (!table_made)
+	{
+		for (wxUint32 i = 0; i < 256; ++i)
+		{
+			wxUint32 c = i;
+			for (int k = 0; k < 8; ++k)
+			{
+				c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			}
+			table[i] = c;
+		}
+		table_made = true;
+	}
+
+	crc = crc ^ 0xFFFFFFFF;
+	for (size_t i = 0; i < length; ++i)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFF;
+}
+
+// put fixed-size numbers into a byte array, least significant byte first
+static void EncodeUInt32 (wxUint8 * bytes, wxUint32 n)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		bytes[i] = (wxUint8)(n >> (8 * i));
+	}
+}
+
+static wxUint32 DecodeUInt32 (const wxUint8 * bytes)
+{
+	wxUint32 n = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		n |= ((wxUint32)bytes[i]) << (8 * i);
+	}
+	return n;
+}
+
+// *** BinaryWriter
+
+BinaryWriter::BinaryWriter (wxFile & file)
+	: _file (file),
+	  _in_section (false),
+	  _section_start (0),
+	  _section_length (0),
+	  _section_crc (0),
+	  _error (false)
+{
+	_buffer.reserve (BUFFER_SIZE);
+}
+
+BinaryWriter::~BinaryWriter ()
+{
+	Flush ();
+}
+
+void BinaryWriter::WriteHeader (wxUint32 num_sections)
+{
+	wxUint8 header[16];
+	memcpy (header, BINARY_MAGIC, BINARY_MAGIC_LENGTH);
+	EncodeUInt32 (header + 8, BINARY_VERSION);
+	EncodeUInt32 (header + 12, num_sections);
+	WriteBytes (header, 16);
+	WriteUInt32 (UpdateCrc32 (0, header, 16));
+}
+
+// write the section tag, and leave space for the length and checksum,
+// which are filled in by EndSection
+void BinaryWriter::BeginSection (wxUint32 tag)
+{
+	assert (!_in_section);
+	WriteUInt32 (tag);
+	Flush ();
+	_section_start = _file.Tell ();
+	WriteUInt64 (0);
+	WriteUInt32 (0);
+	Flush ();
+	_in_section = true;
+	_section_length = 0;
+	_section_crc = 0;
+}
+
+void BinaryWriter::EndSection ()
+{
+	assert (_in_section);
+	Flush ();
+	_in_section = false;
+	wxFileOffset end = _file.Tell ();
+	_file.Seek (_section_start);
+	WriteUInt64 (_section_length);
+	WriteUInt32 (_section_crc);
+	Flush ();
+	_file.Seek (end);
+}
+
+void BinaryWriter::WriteByte (wxUint8 b)
+{
+	_buffer.push_back (b);
+	if (_buffer.size () >= BUFFER_SIZE) Flush ();
+}
+
+void BinaryWriter::WriteUInt32 (wxUint32 n)
+{
+	wxUint8 bytes[4];
+	EncodeUInt32 (bytes, n);
+	WriteBytes (bytes, 4);
+}
+
+void BinaryWriter::WriteUInt64 (wxUint64 n)
+{
+	WriteUInt32 ((wxUint32)(n & 0xFFFFFFFF));
+	WriteUInt32 ((wxUint32)(n >> 32));
+}
+
+void BinaryWriter::WriteVarint (wxUint64 n)
+{
+	while (n >= 0x80)
+	{
+		WriteByte ((wxUint8)(n | 0x80));
+		n >>= 7;
+	}
+	WriteByte ((wxUint8)n);
+}
+
+void BinaryWriter::WriteString (const wxString & str)
+{
+	const wxCharBuffer utf8 = str.utf8_str ();
+	size_t length = strlen (utf8.data ());
+	WriteVarint (length);
+	WriteBytes (utf8.data (), length);
+}
+
+void BinaryWriter::WriteBytes (const void * data, size_t length)
+{
+	const wxUint8 * bytes = (const wxUint8 *)data;
+	_buffer.insert (_buffer.end (), bytes, bytes + length);
+	if (_buffer.size () >= BUFFER_SIZE) Flush ();
+}
+
+// write out the buffer, including it in the section's length and checksum
+bool BinaryWriter::Flush ()
+{
+	if (_buffer.empty ()) return !_error;
+	if (_in_section)
+	{
+		_section_length += _buffer.size ();
+		_section_crc = UpdateCrc32 (_section_crc, &_buffer[0], _buffer.size ());
+	}
+	if (_file.Write (&_buffer[0], _buffer.size ()) != _buffer.size ())
+	{
+		_error = true;
+	}
+	_buffer.clear ();
+	return !_error;
+}
+
+// *** BinaryReader
+
+BinaryReader::BinaryReader (wxFile & file)
+	: _file (file),
+	  _buffer (BUFFER_SIZE),
+	  _position (0),
+	  _end (0),
+	  _in_section (false),
+	  _section_remaining (0),
+	  _section_crc (0),
+	  _expected_crc (0)
+{}
+
+// check if the given file starts with the magic string for binary files
+bool BinaryReader::IsBinaryFile (wxString path)
+{
+	wxFile file;
+	if (!file.Open (path, wxFile::read)) return false;
+	char magic[BINARY_MAGIC_LENGTH];
+	if (file.Read (magic, BINARY_MAGIC_LENGTH) != BINARY_MAGIC_LENGTH) return false;
+	return memcmp (magic, BINARY_MAGIC, BINARY_MAGIC_LENGTH) == 0;
+}
+
+bool BinaryReader::ReadHeader (wxUint32 & num_sections)
+{
+	wxUint8 header[16];
+	wxUint32 crc;
+	if (!ReadBytes (header, 16)) return false;
+	if (!ReadUInt32 (crc)) return false;
+	if (memcmp (header, BINARY_MAGIC, BINARY_MAGIC_LENGTH) != 0) return false;
+	if (crc != UpdateCrc32 (0, header, 16)) return false;
+	if (DecodeUInt32 (header + 8) != BINARY_VERSION) return false; // unknown version
+	num_sections = DecodeUInt32 (header + 12);
+	return true;
+}
+
+bool BinaryReader::BeginSection (wxUint32 & tag)
+{
+	assert (!_in_section);
+	wxUint64 length;
+	if (!ReadUInt32 (tag)) return false;
+	if (!ReadUInt64 (length)) return false;
+	if (!ReadUInt32 (_expected_crc)) return false;
+	_in_section = true;
+	_section_remaining = length;
+	_section_crc = 0;
+	return true;
+}
+
+// skip any unread part of the section, and check its checksum
+bool BinaryReader::EndSection ()
+{
+	assert (_in_section);
+	wxUint8 skip[256];
+	while (_section_remaining > 0)
+	{
+		size_t n = (_section_remaining < sizeof (skip) ? (size_t)_section_remaining : sizeof (skip));
+		if (!ReadBytes (skip, n)) return false;
+	}
+	_in_section = false;
+	return _section_crc == _expected_crc;
+}
+
+bool BinaryReader::ReadByte (wxUint8 & b)
+{
+	return ReadBytes (&b, 1);
+}
+
+bool BinaryReader::ReadUInt32 (wxUint32 & n)
+{
+	wxUint8 bytes[4];
+	if (!ReadBytes (bytes, 4)) return false;
+	n = DecodeUInt32 (bytes);
+	return true;
+}
+
+bool BinaryReader::ReadUInt64 (wxUint64 & n)
+{
+	wxUint32 low, high;
+	if (!ReadUInt32 (low) || !ReadUInt32 (high)) return false;
+	n = ((wxUint64)high << 32) | low;
+	return true;
+}
+
+bool BinaryReader::ReadVarint (wxUint64 & n)
+{
+	n = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		wxUint8 b;
+		if (!ReadByte (b)) return false;
+		n |= ((wxUint64)(b & 0x7F)) << shift;
+		if ((b & 0x80) == 0) return true;
+	}
+	return false; // too many bytes for a 64-bit number
+}
+
+bool BinaryReader::ReadVarint (int & n)
+{
+	wxUint64 value;
+	if (!ReadVarint (value) || value > 0x7FFFFFFF) return false;
+	n = (int)value;
+	return true;
+}
+
+bool BinaryReader::ReadString (wxString & str)
+{
+	wxUint64 length;
+	if (!ReadVarint (length)) return false;
+	if (_in_section && length > _section_remaining) return false;
+	std::vector<char> bytes (length + 1, '\0');
+	if (!ReadBytes (&bytes[0], length)) return false;
+	str = wxString::FromUTF8 (&bytes[0], length);
+	return true;
+}
+
+// copy bytes from the buffer, refilling it from the file as needed
+// -- within a section, cannot read past its end
+bool BinaryReader::ReadBytes (void * data, size_t length)
+{
+	if (_in_section)
+	{
+		if (length > _section_remaining) return false;
+		_section_remaining -= length;
+	}
+	wxUint8 * target = (wxUint8 *)data;
+	while (length > 0)
+	{
+		if (_position == _end && !Fill ()) return false;
+		size_t n = (length < _end - _position ? length : _end - _position);
+		memcpy (target, &_buffer[_position], n);
+		if (_in_section)
+		{
+			_section_crc = UpdateCrc32 (_section_crc, target, n);
+		}
+		_position += n;
+		target += n;
+		length -= n;
+	}
+	return true;
+}
+
+bool BinaryReader::Fill ()
+{
+	ssize_t n = _file.Read (&_buffer[0], _buffer.size ());
+	if (n <= 0) return false;
+	_position = 0;
+	_end = n;
+	return true;
+}
@@ -0,0 +1,96 @@
+#if !defined binaryio_h
+#define binaryio_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <assert.h>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/file.h>
+
+/** BinaryWriter and BinaryReader handle the binary format used to store
+  * a DocumentList (see DocumentList::SaveDocumentList).
+  *
+  * The file begins with a fixed header:
+  *   magic "FERRETDB", u32 version, u32 number of sections, u32 checksum of
+  *   the preceding 16 bytes
+  * followed by a sequence of sections, each with:
+  *   u32 tag, u64 length of payload, u32 checksum of payload, payload
+  * Fixed-size numbers are little-endian.  Within a payload, numbers are
+  * written as varints (7 bits per byte, high bit set on all but the last byte),
+  * and strings as a varint length followed by the UTF-8 bytes.
+  * Checksums are CRC-32.  Readers skip sections with an unknown tag.
+  */
+
+const char BINARY_MAGIC[] = "FERRETDB";
+const int BINARY_MAGIC_LENGTH = 8;
+const wxUint32 BINARY_VERSION = 1;
+
+// make a section tag from four characters
+inline wxUint32 MakeSectionTag (char a, char b, char c, char d)
+{
+	return (wxUint8)a | ((wxUint8)b << 8) | ((wxUint8)c << 16) | ((wxUint32)(wxUint8)d << 24);
+}
+
+wxUint32 UpdateCrc32 (wxUint32 crc, const wxUint8 * data, size_t length);
+
+class BinaryWriter
+{
+	public:
+		BinaryWriter (wxFile & file);
+		~BinaryWriter ();
+		void WriteHeader (wxUint32 num_sections);
+		void BeginSection (wxUint32 tag);
+		void EndSection ();
+		void WriteByte (wxUint8 b);
+		void WriteUInt32 (wxUint32 n);
+		void WriteUInt64 (wxUint64 n);
+		void WriteVarint (wxUint64 n);
+		void WriteString (const wxString & str);
+		void WriteBytes (const void * data, size_t length);
+		bool Flush ();
+		bool HasError () const { return _error; }
+	private:
+		wxFile & _file;
+		std::vector<wxUint8> _buffer;
+		bool _in_section;
+		wxFileOffset _section_start; // -- position of the section's length field
+		wxUint64 _section_length;
+		wxUint32 _section_crc;
+		bool _error;
+};
+
+/** BinaryReader reads through a file written by BinaryWriter.
+  * -- all methods return false on reaching the end of the file or section,
+  *    or on finding a badly formed value
+  * -- EndSection returns false if the payload checksum does not match
+  */
+class BinaryReader
+{
+	public:
+		BinaryReader (wxFile & file);
+		static bool IsBinaryFile (wxString path);
+		bool ReadHeader (wxUint32 & num_sections);
+		bool BeginSection (wxUint32 & tag);
+		bool EndSection ();
+		bool ReadByte (wxUint8 & b);
+		bool ReadUInt32 (wxUint32 & n);
+		bool ReadUInt64 (wxUint64 & n);
+		bool ReadVarint (wxUint64 & n);
+		bool ReadVarint (int & n);
+		bool ReadString (wxString & str);
+		bool ReadBytes (void * data, size_t length);
+	private:
+		bool Fill ();
+		wxFile & _file;
+		std::vector<wxUint8> _buffer;
+		size_t _position; // -- next unread byte in _buffer
+		size_t _end;      // -- end of valid data in _buffer
+		bool _in_section;
+		wxUint64 _section_remaining;
+		wxUint32 _section_crc;
+		wxUint32 _expected_crc;
+};
+
+#endif
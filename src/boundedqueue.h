@@ -0,0 +1,68 @@
+#if !defined boundedqueue_h
+#define boundedqueue_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <deque>
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+/** BoundedQueue passes items from one thread to another, holding at most
+  * a given number of items.
+  * -- Push waits while the queue is full, so a fast producer is held back
+  *    to the pace of its consumers
+  * -- Pop waits while the queue is empty, and returns false once the queue
+  *    is closed and all its items taken
+  * -- any number of threads may push and pop
+  */
+template <class T>
+class BoundedQueue
+{
+	public:
+		BoundedQueue (std::size_t capacity)
+			: _not_empty (_mutex), _not_full (_mutex),
+			  _capacity (capacity < 1 ? 1 : capacity), _closed (false)
+		{}
+		// add an item, waiting for room -- returns false if the queue is closed
+		bool Push (const T & item)
+		{
+			wxMutexLocker lock (_mutex);
+			while (!_closed && _items.size () >= _capacity) _not_full.Wait ();
+			if (_closed) return false;
+			_items.push_back (item);
+			_not_empty.Signal ();
+			return true;
+		}
+		// take the next item, waiting for one -- returns false if the queue is closed and empty
+		bool Pop (T & item)
+		{
+			wxMutexLocker lock (_mutex);
+			while (!_closed && _items.empty ()) _not_empty.Wait ();
+			if (_items.empty ()) return false;
+			item = _items.front ();
+			_items.pop_front ();
+			_not_full.Signal ();
+			return true;
+		}
+		// no more items will be pushed: waiting threads are woken
+		void Close ()
+		{
+			wxMutexLocker lock (_mutex);
+			_closed = true;
+			_not_empty.Broadcast ();
+			_not_full.Broadcast ();
+		}
+	private:
+		BoundedQueue (const BoundedQueue &);             // -- not copyable
+		BoundedQueue & operator= (const BoundedQueue &);
+		wxMutex		_mutex;
+		wxCondition	_not_empty;
+		wxCondition	_not_full;
+		std::deque<T>	_items;
+		std::size_t	_capacity;
+		bool		_closed;
+};
+
+#endif
+
@@ -0,0 +1,168 @@
+#include "contenthash.h"
+
+// constants and steps of XXH64, as given in its specification
+static const wxUint64 PRIME1 = wxULL(11400714785074694791);
+static const wxUint64 PRIME2 = wxULL(14029467366897019727);
+static const wxUint64 PRIME3 = wxULL(1609587929392839161);
+static const wxUint64 PRIME4 = wxULL(9650029242287828579);
+static const wxUint64 PRIME5 = wxULL(2870177450012600261);
+
+static inline wxUint64 RotateLeft (wxUint64 value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline wxUint64 Round (wxUint64 accumulator, wxUint64 input)
+{
+	accumulator += input * PRIME2;
+	accumulator = RotateLeft (accumulator, 31);
+	return accumulator * PRIME1;
+}
+
+static inline wxUint64 MergeRound (wxUint64 accumulator, wxUint64 value)
+{
+	accumulator ^= Round (0, value);
+	return accumulator * PRIME1 + PRIME4;
+}
+
+// read little-endian numbers, whatever the alignment of the bytes
+static inline wxUint64 Read64 (const wxUint8 * bytes)
+{
+	wxUint64 value = 0;
+	for (int i = 7; i >= 0; --i)
+	{
+		value = (value << 8) | bytes[i];
+	}
+	return value;
+}
+
+static inline wxUint32 Read32 (const wxUint8 * bytes)
+{
+	return (wxUint32)bytes[0] | ((wxUint32)bytes[1] << 8) | 
+		((wxUint32)bytes[2] << 16) | ((wxUint32)bytes[3] << 24);
+}
+
+ContentHash::ContentHash (wxUint64 seed)
+{
+	Reset (seed);
+}
+
+void ContentHash::Reset (wxUint64 seed)
+{
+	_seed = seed;
+	_accumulators[0] = seed + PRIME1 + PRIME2;
+	_accumulators[1] = seed + PRIME2;
+	_accumulators[2] = seed;
+	_accumulators[3] = seed - PRIME1;
+	_stripe_length = 0;
+	_total_length = 0;
+}
+
+void ContentHash::ProcessStripe (const wxUint8 * stripe)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		_accumulators[i] = Round (_accumulators[i], Read64 (stripe + 8 * i));
+	}
+}
+
+// bytes are processed in stripes of 32, keeping any remainder for the next call
+void ContentHash::Update (const void * data, size_t length)
+{
+	const wxUint8 * bytes = (const wxUint8 *)data;
+	_total_length += length;
+
+	if (_stripe_length > 0)
+	{
+		size_t n = (length < 32 - _stripe_length ? length : 32 - _stripe_length);
+		memcpy (_stripe + _stripe_length, bytes, n);
+		_stripe_length += n;
+		bytes += n;
+		length -= n;
+		if (_stripe_length < 32) return;
+		ProcessStripe (_stripe);
+		_stripe_length = 0;
+	}
+	while (length >= 32)
+	{
+		ProcessStripe (bytes);
+		bytes += 32;
+		length -= 32;
+	}
+	memcpy (_stripe, bytes, length);
+	_stripe_length = length;
+}
+
+wxUint64 ContentHash::GetHash () const
+{
+	wxUint64 hash;
+	if (_total_length >= 32)
+	{
+		hash = RotateLeft (_accumulators[0], 1) + RotateLeft (_accumulators[1], 7) +
+			RotateLeft (_accumulators[2], 12) + RotateLeft (_accumulators[3], 18);
+		for (int i = 0; i < 4; ++i)
+		{
+			hash = MergeRound (hash, _accumulators[i]);
+		}
+	}
+	else
+	{
+		hash = _seed + PRIME5;
+	}
+	hash += _total_length;
+
+	// -- the remaining bytes, which did not make up a full stripe
+	const wxUint8 * bytes = _stripe;
+	size_t length = _stripe_length;
+	while (length >= 8)
+	{
+		hash ^= Round (0, Read64 (bytes));
+		hash = RotateLeft (hash, 27) * PRIME1 + PRIME4;
+		bytes += 8;
+		length -= 8;
+	}
+	if (length >= 4)
+	{
+		hash ^= (wxUint64)Read32 (bytes) * PRIME1;
+		hash = RotateLeft (hash, 23) * PRIME2 + PRIME3;
+		bytes += 4;
+		length -= 4;
+	}
+	while (length > 0)
+	{
+		hash ^= (*bytes) * PRIME5;
+		hash = RotateLeft (hash, 11) * PRIME1;
+		bytes += 1;
+		length -= 1;
+	}
+
+	// -- final mixing
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+wxUint64 ContentHash::GetLength () const
+{
+	return _total_length;
+}
+
+bool ContentHash::HashFile (wxString path, wxUint64 & hash, wxUint64 & length)
+{
+	wxFile file;
+	if (!file.Open (path, wxFile::read)) return false;
+	ContentHash content;
+	char buffer[1 << 16];
+	ssize_t n;
+	while ((n = file.Read (buffer, sizeof (buffer))) > 0)
+	{
+		content.Update (buffer, n);
+	}
+	if (n < 0) return false;
+	hash = content.GetHash ();
+	length = content.GetLength ();
+	return true;
+}
@@ -0,0 +1,36 @@
+#if !defined contenthash_h
+#define contenthash_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <wx/wx.h>
+#include <wx/file.h>
+
+/** ContentHash computes the 64-bit xxHash (XXH64) of a sequence of bytes,
+  * which may be given in pieces with Update.  It is used to recognise files 
+  * whose contents have not changed since an earlier run, e.g. by TokenCache.
+  * -- the hash is fast, not cryptographic: it detects changed files, but 
+  *    does not protect against files made to collide on purpose
+  */
+class ContentHash
+{
+	public:
+		ContentHash (wxUint64 seed = 0);
+		void Reset (wxUint64 seed = 0);
+		void Update (const void * data, size_t length);
+		wxUint64 GetHash () const;
+		wxUint64 GetLength () const;
+		// hash the whole contents of a file, returning false if it cannot be read
+		static bool HashFile (wxString path, wxUint64 & hash, wxUint64 & length);
+	private:
+		void ProcessStripe (const wxUint8 * stripe);
+		wxUint64 _accumulators[4];
+		wxUint8 _stripe[32];       // -- bytes not yet making up a full stripe
+		size_t _stripe_length;
+		wxUint64 _total_length;
+		wxUint64 _seed;
+};
+
+#endif
+
@@ -0,0 +1,176 @@
+#include "conversionpool.h"
+
+ConversionPool::ConversionPool (int max_processes, int timeout_seconds)
+	: _max_processes (max_processes < 1 ? 1 : max_processes),
+	  _timeout (timeout_seconds)
+{}
+
+ConversionPool::~ConversionPool ()
+{
+	Cancel ();
+}
+
+// one process for each processor
+int ConversionPool::GetDefaultSize ()
+{
+	int cpus = wxThread::GetCPUCount ();
+	return (cpus < 1 ? 1 : cpus);
+}
+
+wxString ConversionPool::GetCommandLine (const wxArrayString & command)
+{
+	wxString command_line = "";
+	for (int i = 0, n = command.GetCount (); i < n; ++i)
+	{
+		if (i > 0) command_line += " ";
+		if (command[i].Find (' ') == wxNOT_FOUND)
+		{
+			command_line += command[i];
+		}
+		else
+		{
+			command_line += "\"" + command[i] + "\"";
+		}
+	}
+	return command_line;
+}
+
+void ConversionPool::Add (int id, const wxArrayString & command)
+{
+	Command waiting;
+	waiting.id = id;
+	waiting.arguments = command;
+	_waiting.push_back (waiting);
+}
+
+int ConversionPool::Size () const
+{
+#if __WXGTK__
+	return _waiting.size () + _running.size ();
+#else
+	return _waiting.size ();
+#endif
+}
+
+#if __WXGTK__
+
+// start waiting commands until the pool is full
+// -- a command which cannot be started is left to be reported by WaitForNext,
+//    as the child exits at once
+void ConversionPool::StartWaiting ()
+{
+	while (!_waiting.empty () && (int)_running.size () < _max_processes)
+	{
+		Command command = _waiting.front ();
+		_waiting.pop_front ();
+
+		// -- prepare arguments before forking, so the child only calls exec
+		std::vector<wxCharBuffer> buffers;
+		std::vector<char *> argv;
+		for (int i = 0, n = command.arguments.GetCount (); i < n; ++i)
+		{
+			buffers.push_back (command.arguments[i].mb_str ());
+		}
+		for (int i = 0, n = buffers.size (); i < n; ++i)
+		{
+			argv.push_back (buffers[i].data ());
+		}
+		argv.push_back (NULL);
+
+		Process process;
+		process.id = command.id;
+		process.started = wxGetLocalTime ();
+		process.pid = fork ();
+		if (process.pid == 0) // -- in child
+		{
+			// keep converters' messages out of reports written to standard output
+			int null_output = open ("/dev/null", O_WRONLY);
+			if (null_output >= 0) dup2 (null_output, 1);
+			execvp (argv[0], &argv[0]);
+			_exit (127);
+		}
+		_running.push_back (process);
+	}
+}
+
+// poll the running processes, as converters may finish in any order
+bool ConversionPool::WaitForNext (int & id, bool & finished)
+{
+	while (Size () > 0)
+	{
+		if (CheckNext (id, finished)) return true;
+		wxMilliSleep (10);
+	}
+	return false;
+}
+
+bool ConversionPool::CheckNext (int & id, bool & finished)
+{
+	StartWaiting ();
+	for (int i = 0, n = _running.size (); i < n; ++i)
+	{
+		Process & process = _running[i];
+		int status = 0;
+		pid_t result = (process.pid < 0 ? -1 : waitpid (process.pid, &status, WNOHANG));
+		bool timed_out = (result == 0 && wxGetLocalTime () - process.started > _timeout);
+		if (timed_out)
+		{
+			kill (process.pid, SIGKILL);
+			waitpid (process.pid, &status, 0);
+		}
+		if (result != 0 || timed_out)
+		{
+			id = process.id;
+			// -- exit code 127 means the converter could not be run
+			finished = (result == process.pid && WIFEXITED (status) && WEXITSTATUS (status) != 127);
+			_running.erase (_running.begin () + i);
+			StartWaiting ();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ConversionPool::Cancel ()
+{
+	_waiting.clear ();
+	for (int i = 0, n = _running.size (); i < n; ++i)
+	{
+		if (_running[i].pid > 0)
+		{
+			int status;
+			kill (_running[i].pid, SIGKILL);
+			waitpid (_running[i].pid, &status, 0);
+		}
+	}
+	_running.clear ();
+}
+
+#else
+
+void ConversionPool::StartWaiting ()
+{}
+
+bool ConversionPool::WaitForNext (int & id, bool & finished)
+{
+	return CheckNext (id, finished);
+}
+
+// run the next command, waiting for it to complete
+bool ConversionPool::CheckNext (int & id, bool & finished)
+{
+	if (_waiting.empty ()) return false;
+	Command command = _waiting.front ();
+	_waiting.pop_front ();
+
+	id = command.id;
+	finished = (wxExecute (GetCommandLine (command.arguments), wxEXEC_SYNC) != -1);
+	return true;
+}
+
+void ConversionPool::Cancel ()
+{
+	_waiting.clear ();
+}
+
+#endif
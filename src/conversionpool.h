@@ -0,0 +1,74 @@
+#if !defined conversionpool_h
+#define conversionpool_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <deque>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <wx/utils.h>
+
+#if __WXGTK__
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/** ConversionPool runs external converters, e.g. pdftotext, as child processes,
+  * with up to a given number running at once.
+  * -- each command is added with an id, and WaitForNext returns the id of 
+  *    each command as it completes, starting waiting commands as others finish
+  * -- a command running for longer than the timeout is stopped
+  * -- the command's first argument is the program, found on the path, and
+  *    the remaining arguments are passed to it unchanged, so file names may
+  *    contain spaces
+  * -- where child processes cannot be managed directly (other than on GTK), 
+  *    commands are run one at a time with wxExecute
+  */
+class ConversionPool
+{
+	public:
+		ConversionPool (int max_processes = GetDefaultSize (), int timeout_seconds = 300);
+		~ConversionPool ();
+		void Add (int id, const wxArrayString & command);
+		// wait for a command to complete, giving its id, and whether it ran to completion
+		// -- returns false when there are no more commands
+		bool WaitForNext (int & id, bool & finished);
+		// as WaitForNext, but without waiting: returns false if no command has completed,
+		// so a caller on the GUI thread can handle events while commands run
+		bool CheckNext (int & id, bool & finished);
+		// stop all running commands, and discard those waiting
+		void Cancel ();
+		int Size () const; // -- commands waiting or running
+		static int GetDefaultSize ();
+		// the command as a single line, quoting arguments which contain spaces
+		static wxString GetCommandLine (const wxArrayString & command);
+	private:
+		ConversionPool (const ConversionPool &);             // -- not copyable
+		ConversionPool & operator= (const ConversionPool &);
+		void StartWaiting ();
+		struct Command
+		{
+			int id;
+			wxArrayString arguments;
+		};
+		std::deque<Command> _waiting;
+#if __WXGTK__
+		struct Process
+		{
+			int id;
+			pid_t pid;
+			long started;
+		};
+		std::vector<Process> _running;
+#endif
+		int _max_processes;
+		int _timeout;
+};
+
+#endif
+
@@ -0,0 +1,153 @@
+#include "converterstream.h"
+#include "conversionpool.h"
+
+#if __WXGTK__
+
+// start the converter with its standard output connected to a pipe
+// -- if the pipe or process cannot be made, the stream is empty
+ConverterStream::ConverterStream (const wxArrayString & command, wxOutputStream * copy, int timeout_seconds)
+	: _copy (copy),
+	  _succeeded (false),
+	  _fd (-1),
+	  _pid (-1),
+	  _deadline (wxGetLocalTime () + timeout_seconds),
+	  _timed_out (false)
+{
+	std::vector<wxCharBuffer> buffers;
+	std::vector<char *> argv;
+	for (int i = 0, n = command.GetCount (); i < n; ++i)
+	{
+		buffers.push_back (command[i].mb_str ());
+	}
+	for (int i = 0, n = buffers.size (); i < n; ++i)
+	{
+		argv.push_back (buffers[i].data ());
+	}
+	argv.push_back (NULL);
+
+	int fds[2];
+	if (argv.size () < 2 || pipe (fds) != 0) return;
+	_pid = fork ();
+	if (_pid == 0) // -- in child
+	{
+		dup2 (fds[1], 1);
+		close (fds[0]);
+		close (fds[1]);
+		execvp (argv[0], &argv[0]);
+		_exit (127);
+	}
+	close (fds[1]);
+	if (_pid < 0)
+	{
+		close (fds[0]);
+		return;
+	}
+	_fd = fds[0];
+}
+
+ConverterStream::~ConverterStream ()
+{
+	Finish ();
+}
+
+// -- closing the pipe stops a converter whose output has not all been read
+// -- exit code 0 means the converter succeeded; 127 that it could not be run
+bool ConverterStream::Finish ()
+{
+	if (_fd >= 0)
+	{
+		close (_fd);
+		_fd = -1;
+	}
+	if (_pid > 0)
+	{
+		int status = 0;
+		waitpid (_pid, &status, 0);
+		_succeeded = !_timed_out && WIFEXITED (status) && WEXITSTATUS (status) == 0;
+		_pid = -1;
+	}
+	return _succeeded;
+}
+
+// -- waits for output until the deadline, then stops the converter
+size_t ConverterStream::OnSysRead (void * buffer, size_t size)
+{
+	ssize_t count = -1;
+	if (_fd >= 0)
+	{
+		struct pollfd ready;
+		ready.fd = _fd;
+		ready.events = POLLIN;
+		int polled = 0;
+		long remaining;
+		while ((remaining = _deadline - wxGetLocalTime ()) > 0)
+		{
+			polled = poll (&ready, 1, 1000 * remaining);
+			if (polled > 0 || (polled < 0 && errno != EINTR)) break;
+		}
+		if (polled == 0)
+		{
+			_timed_out = true;
+			kill (_pid, SIGKILL);
+		}
+		else
+		{
+			do
+			{
+				count = read (_fd, buffer, size);
+			}
+			while (count < 0 && errno == EINTR);
+		}
+	}
+	if (count <= 0)
+	{
+		m_lasterror = (count == 0 ? wxSTREAM_EOF : wxSTREAM_READ_ERROR);
+		return 0;
+	}
+	if (_copy != NULL) _copy->Write (buffer, count);
+	return count;
+}
+
+#else
+
+// -- the converter is run to completion, so is not stopped on the timeout
+ConverterStream::ConverterStream (const wxArrayString & command, wxOutputStream * copy, int timeout_seconds)
+	: _copy (copy),
+	  _succeeded (false),
+	  _position (0)
+{
+	wxArrayString lines;
+	wxArrayString errors;
+	_succeeded = (wxExecute (ConversionPool::GetCommandLine (command), lines, errors) == 0);
+	for (int i = 0, n = lines.GetCount (); i < n; ++i)
+	{
+		_output += lines[i].mb_str ();
+		_output += "\n";
+	}
+}
+
+ConverterStream::~ConverterStream ()
+{}
+
+bool ConverterStream::Finish ()
+{
+	return _succeeded;
+}
+
+size_t ConverterStream::OnSysRead (void * buffer, size_t size)
+{
+	size_t count = _output.size () - _position;
+	if (count > size) count = size;
+	if (count == 0)
+	{
+		m_lasterror = wxSTREAM_EOF;
+		return 0;
+	}
+	memcpy (buffer, _output.data () + _position, count);
+	_position += count;
+	if (_copy != NULL) _copy->Write (buffer, count);
+	return count;
+}
+
+#endif
+
@@ -0,0 +1,61 @@
+#if !defined converterstream_h
+#define converterstream_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <string>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/stream.h>
+#include <wx/utils.h>
+
+#if __WXGTK__
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/** ConverterStream runs an external converter, e.g. pdftotext, which writes 
+  * its text to standard output, and is read as an input stream, so the text
+  * can be tokenised as it is produced, without going through a file.
+  * -- the command is given as in ConversionPool
+  * -- optionally, the text read is also written to a second stream, e.g. to
+  *    keep a copy for display
+  * -- a converter running for longer than the timeout is stopped, as in 
+  *    ConversionPool, and the stream ends
+  * -- Finish returns false if the converter could not be run, was stopped, 
+  *    or failed, e.g. on a damaged or encrypted pdf file
+  * -- where child processes cannot be managed directly (other than on GTK),
+  *    the converter's output is collected with wxExecute, and then read
+  */
+class ConverterStream : public wxInputStream
+{
+	public:
+		ConverterStream (const wxArrayString & command, wxOutputStream * copy = NULL, int timeout_seconds = 300);
+		~ConverterStream ();
+		// wait for the converter to end, returning true if it succeeded
+		bool Finish ();
+	protected:
+		size_t OnSysRead (void * buffer, size_t size);
+	private:
+		ConverterStream (const ConverterStream &);             // -- not copyable
+		ConverterStream & operator= (const ConverterStream &);
+		wxOutputStream * _copy;
+		bool _succeeded; // -- once finished
+#if __WXGTK__
+		int _fd;    // -- read end of pipe from converter
+		pid_t _pid; // -- -1 once finished
+		long _deadline; // -- local time by which the converter must finish
+		bool _timed_out;
+#else
+		std::string _output;
+		size_t _position;
+#endif
+};
+
+#endif
+
@@ -0,0 +1,103 @@
+#include "corpusstatistics.h"
+
+// *** SimilaritySummary
+
+SimilaritySummary::SimilaritySummary ()
+	: _bins (NUM_BINS, 0)
+{
+	Clear ();
+}
+
+void SimilaritySummary::Clear ()
+{
+	_count = 0;
+	_sum = 0.0;
+	_sum_squares = 0.0;
+	_maximum = 0.0;
+	_bins.assign (NUM_BINS, 0);
+}
+
+void SimilaritySummary::AddScore (float score, int count)
+{
+	_count += count;
+	_sum += (double)score * count;
+	_sum_squares += (double)score * score * count;
+	if (score > _maximum) _maximum = score;
+	// -- score of 1.0 goes in last bin
+	int bin = (int)(score * NUM_BINS);
+	if (bin < 0) bin = 0;
+	if (bin >= NUM_BINS) bin = NUM_BINS - 1;
+	_bins[bin] += count;
+}
+
+int SimilaritySummary::GetCount () const
+{
+	return _count;
+}
+
+float SimilaritySummary::GetMean () const
+{
+	if (_count == 0) return 0.0; // check for divide by zero
+	return (float)(_sum / _count);
+}
+
+float SimilaritySummary::GetVariance () const
+{
+	if (_count == 0) return 0.0; // check for divide by zero
+	double mean = _sum / _count;
+	double variance = _sum_squares / _count - mean * mean;
+	if (variance < 0.0) return 0.0; // rounding error
+	return (float)variance;
+}
+
+float SimilaritySummary::GetMaximum () const
+{
+	return _maximum;
+}
+
+// find the bin holding the score at the given rank,
+// and assume scores are spread evenly across that bin
+float SimilaritySummary::GetPercentile (float percent) const
+{
+	assert (percent >= 0.0 && percent <= 100.0);
+	if (_count == 0) return 0.0;
+	float rank = percent / 100.0 * _count;
+	int seen = 0;
+	for (int bin = 0; bin < NUM_BINS; ++bin)
+	{
+		if (_bins[bin] > 0 && seen + _bins[bin] >= rank)
+		{
+			float within = (rank - seen) / _bins[bin];
+			float score = (bin + within) / NUM_BINS;
+			return (score > _maximum ? _maximum : score);
+		}
+		seen += _bins[bin];
+	}
+	return _maximum;
+}
+
+int SimilaritySummary::GetBinCount (int bin) const
+{
+	assert (bin >= 0 && bin < NUM_BINS);
+	return _bins[bin];
+}
+
+// *** CorpusStatistics
+
+void CorpusStatistics::Clear ()
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		_summaries[i].Clear ();
+	}
+}
+
+SimilaritySummary & CorpusStatistics::GetSummary (bool unique, bool ignore)
+{
+	return _summaries[(unique ? 1 : 0) + (ignore ? 2 : 0)];
+}
+
+const SimilaritySummary & CorpusStatistics::GetSummary (bool unique, bool ignore) const
+{
+	return _summaries[(unique ? 1 : 0) + (ignore ? 2 : 0)];
+}
@@ -0,0 +1,53 @@
+#if !defined corpusstatistics_h
+#define corpusstatistics_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <assert.h>
+#include <vector>
+
+/** SimilaritySummary collects the similarity scores of a set of pairs,
+  * keeping enough to report the mean, variance and a histogram.
+  * -- scores lie in [0,1], and are counted into NUM_BINS equal bins
+  * -- percentiles are approximated from the histogram, by interpolating
+  *    within the bin holding the requested rank
+  */
+class SimilaritySummary
+{
+	public:
+		static const int NUM_BINS = 100;
+		SimilaritySummary ();
+		void Clear ();
+		void AddScore (float score, int count = 1); // -- count pairs with the same score
+		int GetCount () const;
+		float GetMean () const;
+		float GetVariance () const;
+		float GetMaximum () const;
+		float GetPercentile (float percent) const; // percent in [0,100]
+		int GetBinCount (int bin) const;
+	private:
+		int _count;
+		double _sum;
+		double _sum_squares;
+		float _maximum;
+		std::vector<int> _bins;
+};
+
+/** CorpusStatistics holds a SimilaritySummary for each of the four
+  * similarity measures: using all or only unique trigrams, and
+  * with or without template material.
+  * -- filled in by DocumentList when first asked for after ComputeSimilarities,
+  *    from the pairs of documents in different groups
+  */
+class CorpusStatistics
+{
+	public:
+		void Clear ();
+		SimilaritySummary & GetSummary (bool unique, bool ignore);
+		const SimilaritySummary & GetSummary (bool unique, bool ignore) const;
+	private:
+		SimilaritySummary _summaries[4];
+};
+
+#endif
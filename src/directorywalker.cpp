@@ -0,0 +1,166 @@
+#include "directorywalker.h"
+
+// -- each thread lists directories until none are left to list
+class DirectoryWalker::ListThread : public wxThread
+{
+	public:
+		ListThread (DirectoryWalker & walker)
+			: wxThread (wxTHREAD_JOINABLE), _walker (walker)
+		{}
+		virtual void * Entry ()
+		{
+			_walker.ListDirectories ();
+			return NULL;
+		}
+	private:
+		DirectoryWalker & _walker;
+};
+
+DirectoryWalker::DirectoryWalker (int num_threads)
+	: _num_threads (num_threads < 1 ? 1 : num_threads),
+	  _ignore_unknown (false),
+	  _changed (_mutex),
+	  _num_listing (0)
+{
+	AddIgnorePattern (".git");
+	AddIgnorePattern (".hg");
+	AddIgnorePattern (".svn");
+	AddIgnorePattern (".bzr");
+	AddIgnorePattern ("CVS");
+	AddIgnorePattern ("node_modules");
+}
+
+void DirectoryWalker::AddIgnorePattern (wxString pattern)
+{
+	_ignore_patterns.push_back (wxString (pattern.wc_str ()));
+}
+
+void DirectoryWalker::SetIgnoreUnknown (bool ignore_unknown)
+{
+	_ignore_unknown = ignore_unknown;
+}
+
+// -- the threads are started for each walk, and finish with it
+void DirectoryWalker::Walk (wxString directory, wxArrayString & files, wxArrayString & ignored)
+{
+	Directory * root = new Directory;
+	root->path = wxString (directory.wc_str ());
+	while (root->path.Len () > 1 && root->path.Last () == wxFILE_SEP_PATH)
+	{
+		root->path.RemoveLast ();
+	}
+	_to_list.push_back (root);
+
+	std::vector<ListThread *> threads;
+	for (int i = 0; i < _num_threads; ++i)
+	{
+		ListThread * thread = new ListThread (* this);
+		thread->Create ();
+		thread->Run ();
+		threads.push_back (thread);
+	}
+	for (int i = 0, n = threads.size (); i < n; ++i)
+	{
+		threads[i]->Wait ();
+		delete threads[i];
+	}
+
+	Collect (root, files, ignored);
+}
+
+// -- run by each ListThread: a thread waits while others are still listing,
+//    as they may find more directories; when none are, the walk is finished
+void DirectoryWalker::ListDirectories ()
+{
+	wxMutexLocker lock (_mutex);
+	while (true)
+	{
+		while (_to_list.empty () && _num_listing > 0) _changed.Wait ();
+		if (_to_list.empty ()) break;
+		Directory * directory = _to_list.front ();
+		_to_list.pop_front ();
+		_num_listing += 1;
+
+		_mutex.Unlock ();
+		ListDirectory (directory);
+		_mutex.Lock ();
+
+		for (int i = 0, n = directory->entries.size (); i < n; ++i)
+		{
+			if (directory->entries[i].directory != NULL) _to_list.push_back (directory->entries[i].directory);
+		}
+		_num_listing -= 1;
+		_changed.Broadcast ();
+	}
+}
+
+// Read the names in a directory, keeping those not ignored
+// -- the path and patterns, made on other threads, are copied with wc_str, and
+//    the strings kept are made on this thread, so none is shared with other threads
+void DirectoryWalker::ListDirectory (Directory * directory)
+{
+	wxString path (directory->path.wc_str ());
+	std::vector<wxString> patterns;
+	for (int i = 0, n = _ignore_patterns.size (); i < n; ++i)
+	{
+		patterns.push_back (wxString (_ignore_patterns[i].wc_str ()));
+	}
+	wxDir dir (path);
+	if (!dir.IsOpened ()) return;
+
+	wxString name;
+	for (bool found = dir.GetFirst (&name, wxEmptyString, wxDIR_DIRS | wxDIR_HIDDEN); found; found = dir.GetNext (&name))
+	{
+		if (IsIgnored (name, patterns)) continue;
+		Entry entry;
+		entry.name = wxString (name.wc_str ());
+		entry.directory = new Directory;
+		entry.directory->path = path + wxFILE_SEP_PATH + name;
+		directory->entries.push_back (entry);
+	}
+	for (bool found = dir.GetFirst (&name, wxEmptyString, wxDIR_FILES | wxDIR_HIDDEN); found; found = dir.GetNext (&name))
+	{
+		if (IsIgnored (name, patterns)) continue;
+		if (_ignore_unknown && Document (path + wxFILE_SEP_PATH + name).IsUnknownType ())
+		{
+			directory->ignored.push_back (path + wxFILE_SEP_PATH + name);
+			continue;
+		}
+		Entry entry;
+		entry.name = wxString (name.wc_str ());
+		entry.directory = NULL;
+		directory->entries.push_back (entry);
+	}
+}
+
+bool DirectoryWalker::IsIgnored (const wxString & name, const std::vector<wxString> & patterns)
+{
+	for (int i = 0, n = patterns.size (); i < n; ++i)
+	{
+		if (wxMatchWild (patterns[i], name, false)) return true;
+	}
+	return false;
+}
+
+// Add the files of the directory to files, in order, deleting the directory
+void DirectoryWalker::Collect (Directory * directory, wxArrayString & files, wxArrayString & ignored)
+{
+	std::sort (directory->entries.begin (), directory->entries.end ());
+	for (int i = 0, n = directory->entries.size (); i < n; ++i)
+	{
+		Entry & entry = directory->entries[i];
+		if (entry.directory != NULL)
+		{
+			Collect (entry.directory, files, ignored);
+		}
+		else
+		{
+			files.Add (directory->path + wxFILE_SEP_PATH + entry.name);
+		}
+	}
+	for (int i = 0, n = directory->ignored.size (); i < n; ++i)
+	{
+		ignored.Add (directory->ignored[i]);
+	}
+	delete directory;
+}
@@ -0,0 +1,73 @@
+#if !defined directorywalker_h
+#define directorywalker_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/dir.h>
+#include <wx/thread.h>
+
+#include "document.h"
+
+/** DirectoryWalker finds the files within a directory and its subdirectories,
+  * listing several directories at once, so large trees, or trees on network
+  * drives, are not held up waiting on each directory in turn.
+  * -- files and directories whose names match an ignore pattern are skipped,
+  *    and ignored directories are not entered: by default, the folders of
+  *    version-control systems and node_modules
+  * -- if ignore_unknown is set, files not of a known document type are left
+  *    out of the files found, and listed separately, so they are not made
+  *    into Documents only to be ignored on extraction
+  * -- the files are returned in a fixed order, whatever order the directories
+  *    were listed in: the entries of each directory are sorted by name, and
+  *    each subdirectory gives its files in its place
+  * -- names are kept as wxStrings, without converting through the locale;
+  *    a string passed to another thread is a private copy, made with wc_str,
+  *    so no string data is shared between threads
+  */
+class DirectoryWalker
+{
+	public:
+		DirectoryWalker (int num_threads = 8);
+		// add a wildcard pattern, e.g. "*.o", matched against file and directory names
+		void AddIgnorePattern (wxString pattern);
+		void SetIgnoreUnknown (bool ignore_unknown);
+		// find the files under directory, adding them to files, and any of unknown type to ignored
+		void Walk (wxString directory, wxArrayString & files, wxArrayString & ignored);
+	private:
+		DirectoryWalker (const DirectoryWalker &);             // -- not copyable
+		DirectoryWalker & operator= (const DirectoryWalker &);
+		struct Directory;
+		struct Entry
+		{
+			wxString name;
+			Directory * directory; // -- NULL for a file
+			bool operator< (const Entry & other) const { return name.Cmp (other.name) < 0; }
+		};
+		struct Directory
+		{
+			wxString path;
+			std::vector<Entry> entries;
+			std::vector<wxString> ignored; // -- files of unknown type
+		};
+		class ListThread;
+		friend class ListThread;
+		void ListDirectories ();
+		void ListDirectory (Directory * directory);
+		static bool IsIgnored (const wxString & name, const std::vector<wxString> & patterns);
+		void Collect (Directory * directory, wxArrayString & files, wxArrayString & ignored);
+		int		_num_threads;
+		std::vector<wxString> _ignore_patterns; // -- copied by each thread, see ListDirectory
+		bool		_ignore_unknown;
+		wxMutex		_mutex;       // -- guards the directories to list, and _num_listing
+		wxCondition	_changed;     // -- signalled as directories are queued or finished
+		std::deque<Directory *>	_to_list;
+		int		_num_listing; // -- directories being listed, which may queue more
+};
+
+#endif
+
@@ -1,27 +1,14 @@
 #include "document.h"
 
-Document::Document (wxString pathname, int id)
+Document::Document (wxString pathname)
 	: _pathname (pathname),
-	  _original_pathname (pathname),
-    _short_path (""),
-	  _num_trigrams (0),
-    _num_unique_trigrams (0),
-    _engagement_count (0),
-	  _group_id (id)
-{
-	wxFileName filename (pathname);
-	_name = filename.GetFullName ();
-}
+	  _original_pathname (pathname)
+{}
 
 Document::Document (Document * document)
 	: _pathname (document->_pathname),
 	  _original_pathname (document->_original_pathname),
-    _short_path (document->_short_path),
-	  _name (document->_name),
-	  _num_trigrams (0),
-    _num_unique_trigrams (0),
-    _engagement_count (0),
-	  _group_id (document->_group_id)
+	  _text_copy (document->_text_copy)
 {}
 
 wxString Document::GetPathname () const 
@@ -47,88 +34,41 @@ void Document::SetPathname (wxString pathname)
 	_pathname = pathname;
 }
 
-void Document::SetShortPath (wxString pathname)
-{
-  _short_path = pathname;
-}
-
-void Document::SetName (wxString name)
-{
-	_name = name;
-}
-
-wxString Document::GetName () const
-{
-	return _name;
-}
-
-wxString Document::GetShortName () const
-{
-  if (_short_path != "")
-  {
-    return _short_path + "/.../" + _name;
-  }
-  else
-  {
-    return _name;
-  }
-}
-
-int Document::GetGroupId () const
-{
-	return _group_id;
-}
-
-void Document::SetGroupId (int id) 
-{
-	_group_id = id;
-}
-
-int Document::GetTrigramCount () const
-{
-	return _num_trigrams;
-}
-
-int Document::GetUniqueTrigramCount () const
-{
-  return _num_unique_trigrams;
-}
-
-int Document::GetEngagementCount () const
-{
-  return _engagement_count;
-}
-
-// WARNING: This method should only be used when document definitions are 
-// loaded from a file.
-void Document::SetTrigramCount (int count)
-{
-	_num_trigrams = count;
-}
-
-void Document::ResetTrigramCount ()
-{
-	_num_trigrams = 0;
-}
-
-void Document::IncrementTrigramCount ()
-{
-	_num_trigrams += 1;
-}
-
-void Document::IncrementUniqueTrigramCount ()
-{
-  _num_unique_trigrams += 1;
-}
-
-void Document::IncrementEngagementTrigramCount ()
-{
-  _engagement_count += 1;
-}
-
 // Start input from the file referred to by this document
+// -- the text of Word and OpenDocument files is read from the archive into memory
 bool Document::StartInput (TokenSet & tokenset)
 {
+	_owns_input = true;
+	_copy_file = NULL;
+	_copy_zip = NULL;
+	_converter = NULL;
+	if (IsPdfType ())
+	{
+		// -- pdf files remain only when streamed: read from pdftotext, while 
+		//    writing a compressed copy of the text for display
+		if (!_text_copy.IsEmpty ())
+		{
+			_copy_file = new wxFileOutputStream (_text_copy);
+			_copy_zip = new wxZlibOutputStream (* _copy_file, -1, wxZLIB_GZIP);
+		}
+		wxArrayString command;
+		GetPdfCommand (GetPathname (), "-", command);
+		_fb = NULL;
+		_converter = new ConverterStream (command, _copy_zip, wxGetApp().GetConversionTimeout ());
+		_cin = _converter;
+		InitialiseInput (tokenset);
+		return true;
+	}
+	if (OfficeText::IsOfficeFile (GetPathname ()))
+	{
+		wxString text;
+		OfficeText::ReadText (GetPathname (), text); // -- an unreadable file gives no text
+		_fb = NULL;
+		_cin = new wxStringInputStream (text);
+		InitialiseInput (tokenset);
+		return true;
+	}
+	_cin = NULL;
 	_fb = new wxFile (GetPathname ());
 	if (_fb->IsOpened ())
 	{
@@ -145,83 +85,185 @@ bool Document::StartInput (TokenSet & tokenset)
 // Start input from a provided input stream
 bool Document::StartInput (wxInputStream & input, TokenSet & tokenset)
 {
+	_owns_input = false;
+	_fb = NULL;
+	_converter = NULL;
 	_cin = &input;
 	InitialiseInput (tokenset);
 	return true;
 }
 
-// Start input by constructing a new Reader based on current document type
-// TokenSet is provided by caller, so Reader uses common set of labels for tokens
-void Document::InitialiseInput (TokenSet & tokenset)
+// -- archive members, streamed pdf files and word-processor files are read
+//    through their own streams
+bool Document::IsPlainFile () const
+{
+	return !ArchiveReader::IsMemberPath (GetPathname ())
+		&& !IsPdfType ()
+		&& !OfficeText::IsOfficeFile (GetPathname ());
+}
+
+// Read the whole text of the document, as seen by StartInput
+bool Document::ReadText (wxString & text) const
+{
+	if (ArchiveReader::IsMemberPath (GetPathname ()))
+	{
+		ArchiveReader archive;
+		wxInputStream * input = archive.OpenMember (GetPathname ());
+		if (input == NULL) return false;
+		wxStringOutputStream output (&text);
+		input->Read (output);
+		return true;
+	}
+	if (IsPdfType ())
+	{
+		if (ReadTextCopy (text)) return true;
+		wxArrayString command;
+		GetPdfCommand (GetPathname (), "-", command);
+		ConverterStream input (command, NULL, wxGetApp().GetConversionTimeout ());
+		wxStringOutputStream output (&text);
+		input.Read (output);
+		return input.Finish ();
+	}
+	if (OfficeText::IsOfficeFile (GetPathname ()))
+	{
+		return OfficeText::ReadText (GetPathname (), text);
+	}
+	wxFFile f (GetPathname (), "rb");
+	return f.IsOpened () && f.ReadAll (&text);
+}
+
+// Converters need a file, so copy an archive member needing conversion 
+// into the extract folder, keeping its name
+bool Document::UnpackMember (wxString & extract_folder, int index)
+{
+	wxString archive_path;
+	wxString member;
+	ArchiveReader archive;
+	wxInputStream * input = archive.OpenMember (_pathname);
+	if (input == NULL || !ArchiveReader::SplitMemberPath (_pathname, archive_path, member)) return false;
+	wxString new_name = "";
+	new_name.Printf ("member-%d-", index);
+	wxFileName new_file (extract_folder, new_name + wxFileName(member, wxPATH_UNIX).GetFullName ());
+	wxFileOutputStream output (new_file.GetFullPath ());
+	if (!output.IsOk ()) return false;
+	input->Read (output);
+	SetPathname (new_file.GetFullPath ());
+	return true;
+}
+
+// Read the compressed copy of a streamed pdf file's text, if there is one
+bool Document::ReadTextCopy (wxString & text) const
+{
+	if (_text_copy.IsEmpty () || !wxFileExists (_text_copy)) return false;
+	wxFFileInputStream file (_text_copy);
+	if (!file.IsOk ()) return false;
+	wxZlibInputStream input (file, wxZLIB_GZIP);
+	wxStringOutputStream output (&text);
+	input.Read (output);
+	return true;
+}
+
+// Create the TokenReader for this type of document, reading from the given stream
+// -- tests must be made in the same order as in GetReaderName
+TokenReader * Document::CreateTokenReader (wxInputStream & input) const
 {
 	if (IsTextType ())
 	{
-		_token_input = new WordReader (* _cin);
+		return new WordReader (input);
 	}
   else if (IsCCodeType ())
 	{
-		_token_input = new CCodeReader (* _cin);
+		return new CCodeReader (input);
 	}
   else if (IsActionScriptCodeType ())
   {
-    _token_input = new ActionScriptCodeReader (* _cin);
+    return new ActionScriptCodeReader (input);
   }
   else if (IsCSharpCodeType ())
 	{
-		_token_input = new CSharpCodeReader (* _cin);
+		return new CSharpCodeReader (input);
 	}
   else if (IsGroovyCodeType ())
   {
-    _token_input = new GroovyCodeReader (* _cin);
+    return new GroovyCodeReader (input);
   }
   else if (IsHaskellCodeType ())
   {
-    _token_input = new HaskellCodeReader (* _cin);
+    return new HaskellCodeReader (input);
   }
   else if (IsJavaCodeType ())
   {
-    _token_input = new JavaCodeReader (* _cin);
+    return new JavaCodeReader (input);
   }
   else if (IsLispCodeType ())
   {
-    _token_input = new LispCodeReader (* _cin);
+    return new LispCodeReader (input);
   }
   else if (IsLuaCodeType ())
   {
-    _token_input = new LuaCodeReader (* _cin);
+    return new LuaCodeReader (input);
   }
   else if (IsPhpCodeType ())
   {
-    _token_input = new PhpCodeReader (* _cin);
+    return new PhpCodeReader (input);
   }
   else if (IsPrologCodeType ())
   {
-    _token_input = new PrologCodeReader (* _cin);
+    return new PrologCodeReader (input);
   }
   else if (IsPythonCodeType ())
   {
-    _token_input = new PythonCodeReader (* _cin);
+    return new PythonCodeReader (input);
   }
   else if (IsRubyCodeType ())
   {
-    _token_input = new RubyCodeReader (* _cin);
+    return new RubyCodeReader (input);
   }
   else if (IsVBCodeType ())
   {
-    _token_input = new VbCodeReader (* _cin);
+    return new VbCodeReader (input);
   }
   else if (IsXmlCodeType ())
   {
-    _token_input = new XmlCodeReader (* _cin);
+    return new XmlCodeReader (input);
   }
   else // default -- treat as text type
   {
-		_token_input = new WordReader (* _cin);
+		return new WordReader (input);
   }
+}
+
+// Start input by constructing a new Reader based on current document type
+// TokenSet is provided by caller, so Reader uses common set of labels for tokens
+void Document::InitialiseInput (TokenSet & tokenset)
+{
+	_token_input = CreateTokenReader (* _cin);
 	ReadTrigram (tokenset); // read first two tokens so next call to 
 	ReadTrigram (tokenset); // ReadTrigram returns the first complete trigram
 }
 
+// Name of the reader chosen by CreateTokenReader, e.g. to tell apart cached tokens
+// -- tests must be made in the same order as in CreateTokenReader
+wxString Document::GetReaderName () const
+{
+	if (IsTextType ())               return "text";
+	else if (IsCCodeType ())         return "c";
+	else if (IsActionScriptCodeType ()) return "actionscript";
+	else if (IsCSharpCodeType ())    return "csharp";
+	else if (IsGroovyCodeType ())    return "groovy";
+	else if (IsHaskellCodeType ())   return "haskell";
+	else if (IsJavaCodeType ())      return "java";
+	else if (IsLispCodeType ())      return "lisp";
+	else if (IsLuaCodeType ())       return "lua";
+	else if (IsPhpCodeType ())       return "php";
+	else if (IsPrologCodeType ())    return "prolog";
+	else if (IsPythonCodeType ())    return "python";
+	else if (IsRubyCodeType ())      return "ruby";
+	else if (IsVBCodeType ())        return "vb";
+	else if (IsXmlCodeType ())       return "xml";
+	else                             return "text";
+}
+
 // returns true if this document's filetype is the same as the given extension
 // -- note, case is ignored, so "txt" == "TXT" == "tXt"
 bool Document::IsFileType (wxString extension) const
@@ -251,6 +293,7 @@ bool Document::IsWordProcessorType () const
 	return 	IsFileType ("abw") ||
 		IsFileType ("doc") ||
 		IsFileType ("docx") ||
+		IsFileType ("odt") ||
 		IsFileType ("rtf");
 }
 
@@ -354,21 +397,69 @@ bool Document::IsUnknownType () const
 // -- returns true to indicate the document is in text form, or has been successfully converted,
 //            and so can be processed by caller
 // -- adds to list of problem files and returns false if there is a problem in conversion
+// -- any converter is run straight away: to run converters for several documents
+//    at once, use StartExtraction and FinishExtraction with a ConversionPool
 bool Document::ExtractDocument (wxString & extract_folder, int index)
 {
+	wxArrayString command;
+	if (!StartExtraction (extract_folder, index, command)) return false;
+
+	bool finished = true;
+	if (!command.IsEmpty ())
+	{
+		ConversionPool pool (1);
+		int id;
+		pool.Add (index, command);
+		pool.WaitForNext (id, finished);
+	}
+	return FinishExtraction (finished);
+}
+
+// First part of ExtractDocument: copies the document, or takes its text from 
+// the extraction cache, where possible, and otherwise gives the converter to 
+// run as command, with its arguments
+// -- returns false if the document is to be ignored
+bool Document::StartExtraction (wxString & extract_folder, int index, wxArrayString & command)
+{
+	command.Clear ();
+	// -- members of archives are read in place, unless they must be converted
+	if (ArchiveReader::IsMemberPath (_pathname))
+	{
+		bool convert = IsPdfType () || 
+			((wxGetApp().GetConvertAll () || IsWordProcessorType ()) &&
+			 (!IsUnknownType () || !wxGetApp().GetIgnoreUnknown ()));
+		if (!convert)
+		{
+			if (wxGetApp().GetIgnoreUnknown () && IsUnknownType ())
+			{
+				wxGetApp().AddIgnoredFile (_original_pathname);
+				return false;
+			}
+			return true;
+		}
+		if (!UnpackMember (extract_folder, index))
+		{
+			wxGetApp().AddProblemFile (_original_pathname);
+			return false;
+		}
+	}
 	wxFileName this_file (_pathname);
 	// consider extension on file and user's selection
 	// -- extract as word-type if we are extracting all or the file type is 
 	//    a word-processor extension
 	// -- if extract all, ignore unknown types if that setting has been selected
-	if ((wxGetApp().GetConvertAll () || IsWordProcessorType ()) &&
+	if (OfficeText::HasText (_pathname))
+	{
+		// -- text of Word and OpenDocument files is read in place, see StartInput
+	}
+	else if ((wxGetApp().GetConvertAll () || IsWordProcessorType ()) &&
 			(!IsUnknownType () || !wxGetApp().GetIgnoreUnknown ()))
 	{
-		ExtractFromWordProcessor (extract_folder, index);
+		ExtractFromWordProcessor (extract_folder, index, command);
 	}
 	else if (IsPdfType ())
 	{
-		ExtractFromPdf (extract_folder, index);
+		ExtractFromPdf (extract_folder, index, command);
 	}
 	else if (wxGetApp().GetCopyAll () &&
 			(IsTxtType () || IsCodeType () || !wxGetApp().GetIgnoreUnknown ()))
@@ -384,31 +475,85 @@ bool Document::ExtractDocument (wxString & extract_folder, int index)
 		wxGetApp().AddIgnoredFile (_original_pathname);
 		return false; // return false so as not to process this document
 	}
+	return true;
+}
 
-	// check that the new document exists
+// Second part of ExtractDocument, once any converter has run
+// -- finished is false if the converter did not run to completion, e.g. it
+//    was stopped on taking too long, in which case any output is discarded
+// -- returns true to process this document
+bool Document::FinishExtraction (bool finished)
+{
+	if (ArchiveReader::IsMemberPath (_pathname)) return true; // -- read in place
 	wxFileName checkfile (_pathname);
+	if (!finished && checkfile.FileExists ())
+	{
+		wxRemoveFile (_pathname);
+	}
+	// check that the new document exists
 	if (!checkfile.FileExists()) // converted file does not exist, so indicate a problem
 	{
 		wxGetApp().AddProblemFile (_original_pathname);
+		_cache_key = "";
 		return false; // return false so as not to process this document
 	}
+	StoreExtractedText (checkfile);
 
 	return true; // return true to process this document
 }
 
+// Copy text from the extraction cache, if it holds the document converted 
+// with the same command line, otherwise keep the key under which to store the text
+// -- key is empty if the cache is not in use
+// -- converter is the command run, made with empty source and target, so the
+//    text is keyed by the converter and its options, as executed
+bool Document::FetchExtractedText (const wxArrayString & converter, wxFileName & new_file)
+{
+	_cache_key = "";
+	ExtractionCache * cache = wxGetApp().GetExtractionCache ();
+	if (cache == NULL) return false;
+	wxArrayString options;
+	for (int i = 0, n = converter.GetCount (); i < n; ++i)
+	{
+		if (!converter[i].IsEmpty ()) options.Add (converter[i]);
+	}
+	wxString key = cache->GetKey (_pathname, ConversionPool::GetCommandLine (options));
+	if (!key.IsEmpty () && cache->Fetch (key, new_file.GetFullPath ())) return true;
+	// -- remove any text left from an earlier run, so a failed conversion is not cached
+	if (new_file.FileExists ()) wxRemoveFile (new_file.GetFullPath ());
+	_cache_key = key;
+	return false;
+}
+
+void Document::StoreExtractedText (wxFileName & new_file)
+{
+	ExtractionCache * cache = wxGetApp().GetExtractionCache ();
+	if (cache != NULL && !_cache_key.IsEmpty () && new_file.FileExists ())
+	{
+		cache->Store (_cache_key, new_file.GetFullPath ());
+	}
+	_cache_key = "";
+}
+
 // Call out to abiword to convert document
 // -- note use of paths so that converted file ends in extract_folder
-void Document::ExtractFromWordProcessor (wxString & extract_folder, int index)
+// -- text already converted on an earlier run is taken from the extraction cache
+// -- on GTK, the call is returned in command, for the caller to run
+void Document::ExtractFromWordProcessor (wxString & extract_folder, int index, wxArrayString & command)
 {
 	wxFileName this_file (_pathname);
   wxString new_name = "";
   new_name.Printf("file-%d.txt", index);
 	wxFileName new_file (extract_folder, new_name);
+	wxArrayString converter;
+	GetWordProcessorCommand ("", "", converter);
+	if (FetchExtractedText (converter, new_file))
+	{
+		SetPathname (new_file.GetFullPath ());
+		return;
+	}
 #if __WXGTK__
-	wxExecute ("abiword --to=txt " + 
-			this_file.GetFullPath () + 
-			" -o " +
-			new_file.GetFullPath (), wxEXEC_SYNC);
+	GetWordProcessorCommand (this_file.GetFullPath (), new_file.GetFullPath (), command);
 #elif __WXMSW__  // different calling sequence for MSW, as cannot handle paths (?? Bad coding ??)
 	// copy old file
 	wxFileName copy_old (extract_folder, this_file.GetFullName ());
@@ -418,11 +563,8 @@ void Document::ExtractFromWordProcessor (wxString & extract_folder, int index)
 	// do the extraction
 	wxArrayString outputs;
 	wxArrayString errors;
-	wxExecute ("\"AbiWord.exe\" --to=txt " + 
-			copy_old.GetFullName () + 
-			" -o " +
-			new_file.GetFullName (), 
-			outputs, errors);
+	GetWordProcessorCommand (copy_old.GetFullName (), new_file.GetFullName (), converter);
+	wxExecute (ConversionPool::GetCommandLine (converter), outputs, errors);
 	// remove the old file 
 	wxRemoveFile (copy_old.GetFullPath ());
 #endif
@@ -431,17 +573,33 @@ void Document::ExtractFromWordProcessor (wxString & extract_folder, int index)
 
 // Call out to pdftotext to convert document
 // -- note use of paths so that converted files ends in extract_folder
-void Document::ExtractFromPdf (wxString & extract_folder, int index)
+// -- text already converted on an earlier run is taken from the extraction cache
+// -- on GTK, the call is returned in command, for the caller to run, unless 
+//    pdf files are streamed
+void Document::ExtractFromPdf (wxString & extract_folder, int index, wxArrayString & command)
 {
 	wxFileName this_file (_pathname);
   wxString new_name = "";
   new_name.Printf("file-%d.txt", index);
 	wxFileName new_file (extract_folder, new_name);
+	wxArrayString converter;
+	GetPdfCommand ("", "", converter);
+	if (FetchExtractedText (converter, new_file))
+	{
+		SetPathname (new_file.GetFullPath ());
+		return;
+	}
 #if __WXGTK__
-	wxExecute ("pdftotext -layout -enc ASCII7 -nopgbrk " + // changed Latin1 to ASCII7
-			this_file.GetFullPath () +
-			" " +
-			new_file.GetFullPath (), wxEXEC_SYNC);
+	if (wxGetApp().GetStreamPdf ())
+	{
+		// -- text is read from pdftotext by StartInput, so the pdf file is kept
+		//    as the document, with a compressed copy of the text for display
+		_cache_key = "";
+		_text_copy = new_file.GetFullPath () + ".gz";
+		if (wxFileExists (_text_copy)) wxRemoveFile (_text_copy);
+		return;
+	}
+	GetPdfCommand (this_file.GetFullPath (), new_file.GetFullPath (), command);
 #elif __WXMSW__   // different calling sequence for MSW, as cannot handle paths (?? Bad coding ??)
 	// copy old file
 	wxFileName copy_old (extract_folder, this_file.GetFullName ());
@@ -451,17 +609,46 @@ void Document::ExtractFromPdf (wxString & extract_folder, int index)
 	// do the extraction
 	wxArrayString outputs;
 	wxArrayString errors;
-	wxExecute ("\"pdftotext\" -layout -enc Latin1 -nopgbrk " + 
-			copy_old.GetFullName () + 
-			" " +
-			new_file.GetFullName (), 
-			outputs, errors);
+	GetPdfCommand (copy_old.GetFullName (), new_file.GetFullName (), converter);
+	wxExecute (ConversionPool::GetCommandLine (converter), outputs, errors);
 	// remove the old file
 	wxRemoveFile (copy_old.GetFullPath ());
 #endif
 	SetPathname (new_file.GetFullPath());
 }
 
+// Call to abiword, writing text of source to target
+void Document::GetWordProcessorCommand (wxString source, wxString target, wxArrayString & command) const
+{
+	command.Clear ();
+#if __WXMSW__
+	command.Add ("AbiWord.exe");
+#else
+	command.Add ("abiword");
+#endif
+	command.Add ("--to=txt");
+	command.Add (source);
+	command.Add ("-o");
+	command.Add (target);
+}
+
+// Call to pdftotext, writing text of source to target, or to standard output if target is "-"
+void Document::GetPdfCommand (wxString source, wxString target, wxArrayString & command) const
+{
+	command.Clear ();
+	command.Add ("pdftotext");
+	command.Add ("-layout");
+	command.Add ("-enc");
+#if __WXMSW__
+	command.Add ("Latin1");
+#else
+	command.Add ("ASCII7"); // changed Latin1 to ASCII7
+#endif
+	command.Add ("-nopgbrk");
+	command.Add (source);
+	command.Add (target);
+}
+
 // Reads next input token and updates information held on current trigram.
 // return true if a trigram has been read and is ready for retrieval
 bool Document::ReadTrigram (TokenSet & tokenset)
@@ -515,19 +702,17 @@ std::size_t Document::GetTrigramEnd () const
 void Document::CloseInput ()
 {
 	delete _token_input;
-	if (_fb != NULL && _fb->IsOpened ())
+	if (!_owns_input) return;
+	if (_converter != NULL && !_converter->Finish ())
 	{
-		_fb->Close ();
+		wxGetApp().AddProblemFile (_original_pathname);
+	}
+	delete _cin;
+	delete _copy_zip; // -- completes the compressed copy
+	delete _copy_file;
+	if (_fb != NULL)
+	{
+		if (_fb->IsOpened ()) _fb->Close ();
+		delete _fb;
 	}
-}
-
-void Document::Save (wxFile & file)
-{
-	file.Write ("start-document\n");
-	file.Write (wxString::Format ("path\t%s\n", _pathname.c_str ()));
-	file.Write (wxString::Format ("original-path\t%s\n", _original_pathname.c_str ()));
-	file.Write (wxString::Format ("name\t%s\n", _name.c_str ()));
-	file.Write (wxString::Format ("num-trigrams\t%d\n", _num_trigrams));
-	file.Write (wxString::Format ("group-id\t%d\n", _group_id));
-	file.Write ("end-document\n");
 }
@@ -6,66 +6,63 @@
   */
 
 #include <wx/wx.h>
+#include <wx/ffile.h>
 #include <wx/file.h>
 #include <wx/filename.h>
+#include <wx/sstream.h>
 #include <wx/wfstream.h>
+#include <wx/zstream.h>
 
+#include "archivereader.h"
+#include "conversionpool.h"
+#include "converterstream.h"
 #include "ferretapp.h"
+#include "officetext.h"
 #include "tokenset.h"
 #include "tokenreader.h"
 
 /** Document points to a document on the local filestore.  
   * -- each Document is initialised with a pathname and the type of a document
   *    or it may take these values from a given Document
-  * -- the group_id is used to place documents into groups: documents with the same id
-  *    will not be compared against each other
+  * -- group id, name and trigram counts are held by DocumentList in its
+  *    DocumentTable, so the comparison loops need not visit each Document
   * -- Document owns a TokenReader, which is created on heap during initialisation
   * -- Note the paths/names for this document:
   *    _original_pathname -- this is the path to the original source form of the document
   *    _pathname -- this is the path to the displayed text form of the document
   *                 When files have been converted to text, this holds the converted file's path.
-  *    _short_path -- this is the base directory for the file provided in select files
-  *                   used in results table to show short pathname
-  *    _name -- this is the 'name' of the document.  For user files, it is the name of the 
-  *             document.
+  *                 Word (.docx) and OpenDocument (.odt) files are not converted: their
+  *                 text is read directly from the file, see OfficeText.
+  *                 When pdf files are streamed, _pathname stays as the pdf file, and 
+  *                 its text is read from pdftotext, keeping a compressed copy in _text_copy.
+  *                 Members of zip/tar archives are read in place, and _pathname 
+  *                 names the member within its archive, see ArchiveReader.
   * -- the important part of the class is the set of methods for iterating 
   *    across the trigrams, using ReadTrigram, GetTrigramStart/End and GetToken
   */
 class Document
 {
 	public:
-		Document (wxString pathname, int id = 0);
+		Document (wxString pathname);
 		Document (Document * document);
 		// basic information about document
 		wxString GetPathname () const;
 		wxString GetOriginalPathname () const;
 		void SetOriginalPathname (wxString pathname);
 		void SetPathname (wxString pathname);
-    void SetShortPath (wxString pathname);
-		void SetName (wxString name);
-		wxString GetName () const;
-    wxString GetShortName () const;
-		// accessor/setter for group_id
-		int GetGroupId () const;
-		void SetGroupId (int id);
-		// information about trigrams in document
-		int GetTrigramCount () const;
-    int GetUniqueTrigramCount () const;
-    int GetEngagementCount () const;
-		void SetTrigramCount (int count);
-		void ResetTrigramCount ();
-		void IncrementTrigramCount ();
-    void IncrementUniqueTrigramCount ();
-    void IncrementEngagementTrigramCount ();
 		// following methods used to start, read and end processing of trigrams
 		bool StartInput (TokenSet & tokenset);
 		bool StartInput (wxInputStream & input, TokenSet & tokenset);
+		bool ReadText (wxString & text) const; // the whole text, for display
 		bool ReadTrigram (TokenSet & tokenset);
 		std::size_t GetToken (int i) const;		// access token of current trigram
 		std::size_t GetTrigramStart () const;		// access start position of trigram
 		std::size_t GetTrigramStart (int i) const;	// access start of token i in trigram
 		std::size_t GetTrigramEnd () const;		// access end position of trigram
+		// -- a streamed pdf file whose conversion failed is reported as a problem file
 		void CloseInput ();
+		// true if StartInput reads the file's own contents, so they may be given as a stream instead
+		bool IsPlainFile () const;
 		// following methods check the type of the document based on its filename
 		bool IsPdfType () const;
 		bool IsTxtType () const;
@@ -87,28 +84,38 @@ class Document
     bool IsXmlCodeType () const;
 		bool IsCodeType () const;
 		bool IsUnknownType () const;
+		// name of the type of TokenReader used for this document
+		wxString GetReaderName () const;
+		// a new TokenReader of that type, owned by the caller
+		TokenReader * CreateTokenReader (wxInputStream & input) const;
 		// extract from non-text formats
 		bool ExtractDocument (wxString & extract_folder, int index); // return true if file should be removed from list
-		void ExtractFromWordProcessor (wxString & extract_folder, int index);
-		void ExtractFromPdf (wxString & extract_folder, int index);
-		// for save/retrieve document data
-		void Save (wxFile & file);
+		bool StartExtraction (wxString & extract_folder, int index, wxArrayString & command);
+		bool FinishExtraction (bool finished);
+		void ExtractFromWordProcessor (wxString & extract_folder, int index, wxArrayString & command);
+		void ExtractFromPdf (wxString & extract_folder, int index, wxArrayString & command);
 	private:
+		void GetWordProcessorCommand (wxString source, wxString target, wxArrayString & command) const;
+		void GetPdfCommand (wxString source, wxString target, wxArrayString & command) const;
+		bool ReadTextCopy (wxString & text) const;
+		bool UnpackMember (wxString & extract_folder, int index);
 		bool IsFileType (wxString extension) const;
 		void InitialiseInput (TokenSet & tokenset);
+		bool FetchExtractedText (const wxArrayString & converter, wxFileName & new_file);
+		void StoreExtractedText (wxFileName & new_file);
 		wxString	  _pathname; 		// -- [converted] source for this document
 		wxString	  _original_pathname;   // -- original source for this document
-    wxString    _short_path;  // -- base directory from select files (if present)
-		wxString 	  _name;		// -- filename (without path)
-		int 		    _num_trigrams;
-    int         _num_unique_trigrams;
-    int         _engagement_count;
+		wxString	  _cache_key;           // -- key for extraction cache, while converting
+		wxString	  _text_copy;           // -- compressed copy of text of streamed pdf file
+		wxOutputStream	* _copy_file;     // -- streams writing the copy, while reading input
+		wxOutputStream	* _copy_zip;
 		wxFile 		* _fb;
 		wxInputStream	* _cin;
+		ConverterStream	* _converter;   // -- _cin, when streaming from a converter
+		bool		  _owns_input;  // -- true if _cin is to be deleted on closing input
 		TokenReader 	* _token_input; // this is a pointer, because initialised separately
 		std::size_t	  _current_tuple[3];
 		std::size_t	  _current_start[3];
-		int		      _group_id;	// an index number indicating this document's group
 };
 
 #endif
@@ -1,4 +1,69 @@
 #include "documentlist.h"
+#include "ingestpipeline.h"
+
+void MatchData::AddMatch (bool is_unique, bool is_template)
+{
+  common += 1;
+  // when we 'ignore' the template material, want to count only 
+  // those trigrams which are not templateMaterial
+  if (!is_template)
+  {
+    ignore += 1;
+  }
+  if (is_unique)
+  {
+    unique += 1;
+    if (!is_template)
+    {
+      unique_ignore += 1;
+    }
+  }
+}
+
+void MatchData::RemoveMatch (bool is_unique, bool is_template)
+{
+  common -= 1;
+  if (!is_template)
+  {
+    ignore -= 1;
+  }
+  if (is_unique)
+  {
+    unique -= 1;
+    if (!is_template)
+    {
+      unique_ignore -= 1;
+    }
+  }
+}
+
+void MatchData::Add (const MatchData & other)
+{
+  common += other.common;
+  unique += other.unique;
+  ignore += other.ignore;
+  unique_ignore += other.unique_ignore;
+}
+
+int MatchData::GetCount (bool unique_only, bool ignore_template) const
+{
+  if (unique_only && ignore_template)
+  {
+    return unique_ignore;
+  }
+  else if (unique_only && !ignore_template)
+  {
+    return unique;
+  }
+  else if (!unique_only && ignore_template)
+  {
+    return ignore;
+  }
+  else // (!unique_only && !ignore_template)
+  {
+    return common;
+  }
+}
 
 DocumentList::~DocumentList ()
 {
@@ -10,21 +75,54 @@ bool DocumentList::IsGrouped () const
   return (_group_names.size () > 0);
 }
 
-// pathname may be a single file or a directory name
-// -- recurse through directories, and add all files to the list
-// -- if grouped is set, give all files in directory same id
+// pathname may be a single file, a directory name or an archive
+// -- recurse through directories, and add all files to the list, 
+//    except those ignored by the DirectoryWalker
+// -- add all files in zip/tar archives, to be read from the archive
+// -- if grouped is set, give all files in directory or archive same id
 // -- if id0 is set, give all files id=0
 void DocumentList::AddDocument (wxString pathname, bool grouped, bool id0)
 {
   if (id0) _has_template_material = true;
 
-  if (wxFileName::DirExists (pathname))
+  bool is_archive = !wxFileName::DirExists (pathname) && ArchiveReader::IsArchive (pathname);
+  if (wxFileName::DirExists (pathname) || is_archive)
   {
     wxFileName filename (pathname);
     wxString short_name = filename.GetName ();
 
     wxArrayString files;
-    wxDir::GetAllFiles (pathname, &files, wxEmptyString);
+    wxArrayString names;
+    if (is_archive)
+    {
+      if (short_name.Lower().EndsWith (".tar")) short_name = short_name.Left (short_name.Len () - 4);
+      wxArrayString members;
+      ArchiveReader::ListMembers (pathname, members);
+      for (int i = 0; i < members.GetCount (); i += 1)
+      {
+        files.Add (ArchiveReader::GetMemberPath (pathname, members[i]));
+        names.Add (wxFileName(members[i], wxPATH_UNIX).GetFullName ());
+      }
+    }
+    else
+    {
+      DirectoryWalker walker;
+      for (int i = 0; i < _ignore_patterns.GetCount (); i += 1)
+      {
+        walker.AddIgnorePattern (_ignore_patterns[i]);
+      }
+      walker.SetIgnoreUnknown (wxGetApp().GetIgnoreUnknown ());
+      wxArrayString ignored;
+      walker.Walk (pathname, files, ignored);
+      for (int i = 0; i < ignored.GetCount (); i += 1)
+      {
+        wxGetApp().AddIgnoredFile (ignored[i]);
+      }
+      for (int i = 0; i < files.GetCount (); i += 1)
+      {
+        names.Add (wxFileName(files[i]).GetFullName ());
+      }
+    }
 
     int id = -1;
     for (int i=0; i < files.GetCount (); i += 1)
@@ -47,9 +145,8 @@ void DocumentList::AddDocument (wxString pathname, bool grouped, bool id0)
       {
         _group_names[id] = short_name;
       }
-      Document * newDocument = new Document (files[i], id);
-      newDocument->SetShortPath (short_name); // use the last directory name
-      _documents.push_back (newDocument);
+      // use the last directory name as the short path
+      AppendDocument (new Document (files[i]), id, names[i], short_name);
     }
   }
   else 
@@ -57,7 +154,7 @@ void DocumentList::AddDocument (wxString pathname, bool grouped, bool id0)
     wxFileName filename (pathname);
     if (filename.IsFileReadable ())
     {
-  	  _documents.push_back (new Document (pathname, (id0 ? 0 : GetNewGroupId ())));
+  	  AppendDocument (new Document (pathname), (id0 ? 0 : GetNewGroupId ()), filename.GetFullName ());
     }
   }
 }
@@ -86,7 +183,7 @@ bool DocumentList::IsTemplateMaterial (int i) const
   }
   else
   {
-    return (_documents[i]->GetGroupId () == 0);
+    return (_table.GetGroupId (i) == 0);
   }
 }
 
@@ -98,7 +195,7 @@ wxString DocumentList::GetGroupName (int index)
   }
   else
   {
-    return _documents[index]->GetName ();
+    return _table.GetName (index);
   }
 }
 
@@ -110,12 +207,18 @@ void DocumentList::AddDocument (wxString pathname, wxString name, int id)
   wxFileName filename (pathname);
   if (filename.IsFileReadable ())
   {
-  	Document * doc = new Document (pathname, id);
-  	doc->SetName (name);
-  	_documents.push_back (doc);
+  	AppendDocument (new Document (pathname), id, name);
   }
 }
 
+// add document to end of list, with its entry in the document table
+void DocumentList::AppendDocument (Document * doc, int id, wxString name, wxString short_path)
+{
+	_documents.push_back (doc);
+	_table.Append (id, name, short_path);
+	_num_pairs = -1;
+}
+
 // Use file defined in pathname as a list of definitions
 // -- returns true if managed to open and process definition file correctly
 bool DocumentList::AddDocumentsFromDefinitionFile (wxString pathname)
@@ -157,6 +260,26 @@ bool DocumentList::AddDocumentsFromDefinitionFile (wxString pathname)
 	return true;
 }
 
+// -- paths may be files, directories or archives, as on the command line, 
+//    and are added as they are read, so a long list need not be held first
+void DocumentList::AddDocumentsFromPathList (std::istream & input)
+{
+	std::string path;
+	while (std::getline (input, path, '\0'))
+	{
+		if (path.empty ()) continue;
+		if (wxFileName::IsFileReadable (path.c_str ()))
+		{
+			AddDocument (path.c_str ());
+		}
+	}
+}
+
+void DocumentList::AddIgnorePattern (wxString pattern)
+{
+	_ignore_patterns.Add (pattern);
+}
+
 Document * DocumentList::operator [] (std::size_t i) const
 {
 	assert (i >= 0 && i < _documents.size ());
@@ -165,13 +288,16 @@ Document * DocumentList::operator [] (std::size_t i) const
 
 void DocumentList::RemoveDocument (Document * doc)
 {
-	for (std::vector<Document *>::iterator it = _documents.begin();
-		it != _documents.end();
-		++it)
+	ExpandDuplicates (); // -- copies are known by index
+	for (int i = 0, n = _documents.size (); i < n; ++i)
 	{
-		if (*it == doc)
+		if (_documents[i] == doc)
 		{
-			_documents.erase (it);
+			_documents.erase (_documents.begin () + i);
+			_table.Erase (i);
+			if (_signatures.GetNumHashes () > 0) _signatures.RemoveSignature (i);
+			_num_pairs = -1;
+			if (i < _num_compared_documents) _num_compared_documents = 0;
 			return;
 		}
 	}
@@ -184,6 +310,7 @@ TokenSet & DocumentList::GetTokenSet ()
 
 TupleSet & DocumentList::GetTupleSet ()
 {
+	ExpandDuplicates ();
 	return _tuple_set;
 }
 
@@ -195,6 +322,7 @@ void DocumentList::Clear ()
 		delete _documents[i];
 	}
 	_documents.clear ();
+	_table.Clear ();
 	ResetReading ();
 }
 
@@ -209,7 +337,20 @@ void DocumentList::ResetReading ()
 {
 	_token_set.Clear ();
 	_tuple_set.Clear ();
+	_signatures.Clear ();
+	_token_hashes.clear ();
+	_index.Close ();
 	_matches.clear ();
+	_group_matches.clear ();
+	_group_unique_counts.clear ();
+	_group_engagement_counts.clear ();
+	_statistics.Clear ();
+	_has_statistics = false;
+	_duplicate_of.clear ();
+	_num_pairs = -1;
+	_num_compared_documents = 0;
+	_num_segment_documents = 0;
+	_num_segment_tokens = 0;
 }
 
 int DocumentList::Size () const
@@ -217,17 +358,54 @@ int DocumentList::Size () const
 	return _documents.size ();
 }
 
+int DocumentList::GetGroupId (int i) const
+{
+	return _table.GetGroupId (i);
+}
+
+wxString DocumentList::GetName (int i) const
+{
+	return _table.GetName (i);
+}
+
+// short name includes the base directory from select files, if present
+wxString DocumentList::GetShortName (int i) const
+{
+	return _table.GetShortName (i);
+}
+
 // don't count pairs of documents in same group
+// -- the count is kept after ComputeSimilarities, until the list changes
 int DocumentList::NumberOfPairs () const
 {
-  int num_pairs = 0;
-  for (int i = 0; i < _documents.size (); ++i)
-    for (int j = i+1; j < _documents.size (); ++j)
-    {
-      if (_documents[i]->GetGroupId () != _documents[j]->GetGroupId ())
-        num_pairs++;
-    }
-  return num_pairs;
+  if (_num_pairs >= 0)
+  {
+    return _num_pairs;
+  }
+  else
+  {
+    return CountPairs ();
+  }
+}
+
+// count pairs from the size of each group: of the n*n ordered pairs, 
+// remove the size*size pairs within each group, and halve
+int DocumentList::CountPairs () const
+{
+  const std::vector<int> & group_ids = _table.GetGroupIds ();
+  std::map<int, long long> group_sizes;
+  for (int i = 0, n = group_ids.size (); i < n; ++i)
+  {
+    group_sizes[group_ids[i]] += 1;
+  }
+  long long num_docs = group_ids.size ();
+  long long same_group = 0;
+  for (std::map<int, long long>::const_iterator it = group_sizes.begin (); 
+      it != group_sizes.end (); ++it)
+  {
+    same_group += it->second * it->second;
+  }
+  return (int)((num_docs * num_docs - same_group) / 2);
 }
 
 bool DocumentList::MayNeedConversions () const
@@ -245,293 +423,1565 @@ bool DocumentList::MayNeedConversions () const
 void DocumentList::RunFerret (int first_document)
 {
 	// phase 1 -- read each file in turn, finding trigrams
-	for (int i = first_document; i < _documents.size (); ++i)
+	// -- or overlap reading, tokenising and indexing files in a pipeline
+	// -- files with the same contents as an earlier file are read once
+	// -- winnowing needs the trigrams of a file in sequence, which the 
+	//    pipeline does not keep, so then files are read one at a time
+	FindDuplicates (first_document);
+	_ingest_report = "";
+	if (_ingest_workers > 0 && _winnow_window == 0)
+	{
+		IngestPipeline pipeline (* this, _ingest_workers);
+		pipeline.Run (first_document, _documents.size ());
+		_ingest_report = pipeline.GetReport ();
+	}
+	else
 	{
-		ReadDocument (i);
+		for (int i = first_document; i < _documents.size (); ++i)
+		{
+			ReadDocument (i);
+		}
 	}
 
 	// phase 2 -- compute the similarities
 	ComputeSimilarities ();
 }
 
+// -- rereading a document already compared means all similarities must be recomputed
+// -- a copy found by FindDuplicates is not read
+// -- with a token cache, the trigrams of a file whose contents are unchanged 
+//    are taken from the cache, and otherwise are added to the cache
+// -- the trigrams make the document's signature, if signatures are kept, 
+//    and in approximate mode are not added to _tuple_set
+// -- when winnowing, only the fingerprints are added, and these are what 
+//    the cache keeps, under a name for the reader and window
 void DocumentList::ReadDocument (int i)
 {
-	_documents[i]->StartInput (_token_set);
-	_documents[i]->ResetTrigramCount ();
+	if (i < _num_compared_documents) _num_compared_documents = 0;
+	std::map<int, int>::const_iterator duplicate = _duplicate_of.find (i);
+	if (duplicate != _duplicate_of.end ())
+	{
+		// -- a copy has the trigrams of the document it copies, which stands for it
+		_table.SetTrigramCount (i, _table.GetTrigramCount (duplicate->second));
+		if (_signatures.GetNumHashes () > 0) _signatures.CopySignature (duplicate->second, i);
+		return;
+	}
+	wxUint64 hash;
+	wxUint64 length;
+	bool use_cache = (_token_cache != NULL && 
+			ContentHash::HashFile (_documents[i]->GetPathname (), hash, length));
+	wxString reader = _documents[i]->GetReaderName ();
+	if (_winnow_window > 0) reader += wxString::Format ("-winnow%d", _winnow_window);
+	std::vector<wxString> tokens;
+	std::vector<wxUint32> trigrams;
+	if (use_cache && _token_cache->Lookup (hash, length, reader, tokens, trigrams))
+	{
+		AddCachedTrigrams (i, tokens, trigrams);
+		return;
+	}
+
+	std::vector<std::size_t> found; // -- trigrams new to this document, kept for the cache
+	_table.SetTrigramCount (i, 0);
+	if (ArchiveReader::IsMemberPath (_documents[i]->GetPathname ()))
+	{
+		// -- read straight from the archive, which is kept open for its next member
+		// -- a member which cannot be read is reported, and gives no trigrams
+		wxInputStream * input = _archive.OpenMember (_documents[i]->GetPathname ());
+		if (input == NULL)
+		{
+			wxGetApp().AddProblemFile (_documents[i]->GetOriginalPathname ());
+			if (_signatures.GetNumHashes () > 0) _signatures.SetSignature (i, std::vector<wxUint64> ());
+			return;
+		}
+		_documents[i]->StartInput (* input, _token_set);
+	}
+	else
+	{
+		_documents[i]->StartInput (_token_set);
+	}
+	bool is_template = (_table.GetGroupId (i) == 0);
+	std::set<wxUint64> signature_trigrams;
+	Winnower winnower (_winnow_window);
 	while ( _documents[i]->ReadTrigram (_token_set) )
 	{
-		if (_tuple_set.AddDocument (
-					_documents[i]->GetToken (0),
-					_documents[i]->GetToken (1),
-					_documents[i]->GetToken (2),
-					i,
-          _documents[i]->GetGroupId () == 0)) // True if template material
+		std::size_t t0 = _documents[i]->GetToken (0);
+		std::size_t t1 = _documents[i]->GetToken (1);
+		std::size_t t2 = _documents[i]->GetToken (2);
+		if (_winnow_window > 0)
+		{
+			wxUint64 trigram_hash = Winnower::HashTrigram (GetTokenHash (t0), GetTokenHash (t1), GetTokenHash (t2));
+			if (!winnower.Add (trigram_hash, t0, t1, t2)) continue;
+			t0 = winnower.GetToken (0);
+			t1 = winnower.GetToken (1);
+			t2 = winnower.GetToken (2);
+		}
+		if (AddTrigram (i, t0, t1, t2, is_template, signature_trigrams) && use_cache)
+		{
+			found.push_back (t0);
+			found.push_back (t1);
+			found.push_back (t2);
+		}
+	}
+	if (_winnow_window > 0 && winnower.Finish ())
+	{
+		if (AddTrigram (i, winnower.GetToken (0), winnower.GetToken (1), winnower.GetToken (2), 
+					is_template, signature_trigrams) && use_cache)
 		{
-			_documents[i]->IncrementTrigramCount ();
+			for (int k = 0; k < 3; ++k) found.push_back (winnower.GetToken (k));
 		}
 	}
 	_documents[i]->CloseInput ();
-}
-
-void DocumentList::ClearSimilarities ()
-{
-	for (int i=0; i < _documents.size() * _documents.size(); ++i)
+	if (_signatures.GetNumHashes () > 0)
 	{
-		_matches.push_back (new MatchData());
+		_signatures.SetSignature (i, std::vector<wxUint64> (signature_trigrams.begin (), signature_trigrams.end ()));
 	}
-}
 
-void DocumentList::ComputeSimilarities ()
-{
-	ClearSimilarities ();
-	for (_tuple_set.Begin (); _tuple_set.HasMore (); _tuple_set.GetNext ())
+	if (use_cache)
 	{
-		const std::vector<int> & fvector = _tuple_set.GetDocumentsForCurrentTuple ();
-    // if fvector is only size 1, then that tuple is unique to the document
-    // so keep track of the number of unique tuples
-    if (fvector.size () == 1) 
-    {
-      _documents[fvector[0]]->IncrementUniqueTrigramCount ();
-    }
-    // if any of the files is id = 0 then the tuple is contained in template material
-    bool templateMaterial = false;
-    for (int i = 0; i < fvector.size (); i += 1)
-    {
-      if (_documents[fvector[i]]->GetGroupId () == 0)
-      {
-        templateMaterial = true;
-        break;
-      }
-    }
-    // for template material, increase EngagementCount for all other documents
-    if (templateMaterial)
-    {
-      for (int i = 0; i < fvector.size (); i += 1)
-      {
-        if (_documents[fvector[i]]->GetGroupId () != 0)
-        {
-          _documents[fvector[i]]->IncrementEngagementTrigramCount ();
-        }
-      }
-    }
-
-		// take each pair of documents in the vector, and add one to matches
-		for (unsigned int fi = 0, n = fvector.size (); fi < n; ++fi)
+		// number the tokens of the entry in order of first use
+		std::map<std::size_t, wxUint32> local_tokens;
+		for (std::size_t k = 0, n = found.size (); k < n; ++k)
 		{
-			for (unsigned int fj=fi+1; fj < n; ++fj)
+			std::map<std::size_t, wxUint32>::iterator it = local_tokens.find (found[k]);
+			if (it == local_tokens.end ())
 			{
-				// ensure that first index is smaller than the second
-				int doc1 = fvector[(fi <= fj ? fi : fj)];
-				int doc2 = fvector[(fi <= fj ? fj : fi)];
-        int matchIndex = doc1 * _documents.size() + doc2;
-				assert (matchIndex < _matches.size());
-				_matches[matchIndex]->common += 1;
-        // when we 'ignore' the template material, want to count only 
-        // those trigrams which are not templateMaterial
-        if (!templateMaterial)
-        {
-          _matches[matchIndex]->ignore += 1;
-        }
-        if (fvector.size () == 2) 
-        {
-          _matches[matchIndex]->unique += 1;
-          if (!templateMaterial) // && fvector.size () == 2
-          {
-            _matches[matchIndex]->unique_ignore += 1;
-          }
-        }
+				it = local_tokens.insert (std::make_pair (found[k], (wxUint32)tokens.size ())).first;
+				tokens.push_back (_token_set.GetStringFor (found[k]));
 			}
+			trigrams.push_back (it->second);
 		}
-
+		_token_cache->Store (hash, length, reader, tokens, trigrams);
 	}
 }
 
-int DocumentList::GetTotalTrigramCount ()
+// -- the trigrams are added as from the cache, and the cache entry for a new file 
+//    holds just the tokens used in trigrams, in order of first use, as in ReadDocument
+void DocumentList::AddReadTrigrams (int i, const std::vector<wxString> & tokens, const std::vector<wxUint32> & trigrams,
+		bool cached, wxUint64 hash, wxUint64 length)
 {
-	return _tuple_set.Size ();
+	if (i < _num_compared_documents) _num_compared_documents = 0;
+	AddCachedTrigrams (i, tokens, trigrams);
+	if (_token_cache == NULL || cached) return;
+
+	std::vector<wxString> cached_tokens;
+	std::vector<wxUint32> cached_trigrams;
+	std::map<wxUint32, wxUint32> local_tokens;
+	for (std::size_t k = 0, n = trigrams.size (); k < n; ++k)
+	{
+		std::map<wxUint32, wxUint32>::iterator it = local_tokens.find (trigrams[k]);
+		if (it == local_tokens.end ())
+		{
+			it = local_tokens.insert (std::make_pair (trigrams[k], (wxUint32)cached_tokens.size ())).first;
+			cached_tokens.push_back (tokens[trigrams[k]]);
+		}
+		cached_trigrams.push_back (it->second);
+	}
+	_token_cache->Store (hash, length, _documents[i]->GetReaderName (), cached_tokens, cached_trigrams);
 }
 
-// return a count of the trigrams in document i
-int DocumentList::CountTrigrams (int doc_i) 
+// -- only documents read without winnowing are looked up here, so the
+//    entry is named by the reader alone
+bool DocumentList::LookupCachedTrigrams (int i, wxUint64 hash, wxUint64 length,
+		std::vector<wxString> & tokens, std::vector<wxUint32> & trigrams) const
 {
- return _documents[doc_i]->GetTrigramCount ();
+	return _token_cache != NULL &&
+		_token_cache->Lookup (hash, length, _documents[i]->GetReaderName (), tokens, trigrams);
 }
 
-int DocumentList::CountMatches (int doc_i, int doc_j, bool unique, bool ignore_template)
+void DocumentList::SetIngestWorkers (int workers)
 {
-  int matchIndex = doc_i * _documents.size() + doc_j;
-	assert (doc_j > doc_i); // _matches is only completed from one side, with doc_j > doc_i
-	assert (matchIndex < _matches.size());
-  if (unique && ignore_template)
-  {
-    return _matches[matchIndex]->unique_ignore;
-  }
-  else if (unique && !ignore_template)
-  {
-    return _matches[matchIndex]->unique;
-  }
-  else if (!unique && ignore_template)
-  {
-    return _matches[matchIndex]->ignore;
-  }
-  else // (!unique && !ignore_template)
-  {
-	  return _matches[matchIndex]->common;
-  }
+	_ingest_workers = (workers < 0 ? 0 : workers);
 }
 
-float DocumentList::ComputeResemblance (int doc_i, int doc_j, bool unique, bool ignore)
+wxString DocumentList::GetIngestReport () const
 {
-	float num_matches = (float)CountMatches (doc_i, doc_j, unique, ignore);
-	float total_trigrams = (float)(CountTrigrams (doc_i) + CountTrigrams (doc_j) - num_matches);
-	if (total_trigrams == 0.0) return 0.0; // check for divide by zero
-	return num_matches/total_trigrams;
+	return _ingest_report;
 }
 
-float DocumentList::ComputeContainment (int doc_i, int doc_j, bool unique, bool ignore)
+// Add the trigrams of document i, as read from the token cache
+void DocumentList::AddCachedTrigrams (int i, const std::vector<wxString> & tokens, const std::vector<wxUint32> & trigrams)
 {
-	float num_matches = (float)(doc_j > doc_i ? CountMatches (doc_i, doc_j, unique, ignore) : CountMatches (doc_j, doc_i, unique, ignore));
-	float target_trigrams = (float)(CountTrigrams (doc_j));
-	if (target_trigrams == 0.0) return 0.0; // check for divide by zero
-	return num_matches/target_trigrams;
+	std::vector<std::size_t> token_ids (tokens.size ());
+	for (std::size_t k = 0, n = tokens.size (); k < n; ++k)
+	{
+		token_ids[k] = _token_set.GetIndexFor (tokens[k]);
+	}
+	_table.SetTrigramCount (i, 0);
+	bool is_template = (_table.GetGroupId (i) == 0);
+	std::set<wxUint64> signature_trigrams;
+	for (std::size_t k = 0, n = trigrams.size (); k + 2 < n; k += 3)
+	{
+		AddTrigram (i, token_ids[trigrams[k]], token_ids[trigrams[k+1]], token_ids[trigrams[k+2]],
+				is_template, signature_trigrams);
+	}
+	if (_signatures.GetNumHashes () > 0)
+	{
+		_signatures.SetSignature (i, std::vector<wxUint64> (signature_trigrams.begin (), signature_trigrams.end ()));
+	}
 }
 
-// unique count adds up all counts for files in given group index,
-// or returns document's unique count if no groups used.
-int DocumentList::UniqueCount (int index) const
+// Add a trigram of document i to its signature, if signatures are kept, and 
+// unless approximate, to the tuples, counting it if new to the document
+// -- returns true if the trigram is new to the document
+bool DocumentList::AddTrigram (int i, std::size_t t0, std::size_t t1, std::size_t t2, bool is_template, 
+		std::set<wxUint64> & signature_trigrams)
 {
-  if (IsGrouped ())
-  {
-    int total = 0;
-    for (int i = 0; i < _documents.size (); i++)
-    {
-      if (_documents[i]->GetGroupId () == index+1)
-      {
-        total += _documents[i]->GetUniqueTrigramCount ();
-      }
-    }
-    return total;
-  }
-  else
-  {
-    return _documents[index]->GetUniqueTrigramCount ();
-  }
+	bool is_new = (_signatures.GetNumHashes () > 0 && 
+			signature_trigrams.insert (SignatureSet::HashTrigram (t0, t1, t2)).second);
+	if (!IsApproximate ())
+	{
+		is_new = _tuple_set.AddDocument (t0, t1, t2, i, is_template);
+	}
+	if (is_new) _table.IncrementTrigramCount (i);
+	return is_new;
 }
 
-// engagement count adds up all counts for files in given group index,
-// or returns document's unique count if no groups used.
-int DocumentList::EngagementCount (int index) const
+// the hash of the text of a token, kept for each token as first needed
+wxUint64 DocumentList::GetTokenHash (std::size_t token)
 {
-  if (IsGrouped ())
-  {
-    int total = 0;
-    for (int i = 0; i < _documents.size (); i++)
-    {
-      if (_documents[i]->GetGroupId () == index+1)
-      {
-        total += _documents[i]->GetEngagementCount ();
-      }
-    }
-    return total;
-  }
-  else
-  {
-    return _documents[index]->GetEngagementCount ();
-  }
+	while (_token_hashes.size () <= token)
+	{
+		// -- hashed as UTF-8, so the hash does not depend on the locale
+		const wxCharBuffer text = _token_set.GetStringFor (_token_hashes.size ()).utf8_str ();
+		ContentHash hash;
+		hash.Update (text.data (), strlen (text.data ()));
+		_token_hashes.push_back (hash.GetHash ());
+	}
+	return _token_hashes[token];
 }
 
-bool DocumentList::IsMatchingTrigram (std::size_t t0, std::size_t t1, std::size_t t2, int doc1, int doc2, bool unique, bool ignore)
+void DocumentList::SetTokenCache (TokenCache * cache)
 {
-	return _tuple_set.IsMatchingTuple (t0, t1, t2, doc1, doc2, unique, ignore);
+	_token_cache = cache;
 }
 
-bool DocumentList::IsTemplateTrigram (std::size_t t0, std::size_t t1, std::size_t t2)
+bool DocumentList::UsesTokenCache () const
 {
-  return _tuple_set.IsTemplateTuple (t0, t1, t2);
+	return _token_cache != NULL;
 }
 
-wxString DocumentList::MakeTrigramString (std::size_t t0, std::size_t t1, std::size_t t2)
+void DocumentList::SetMinHash (int num_hashes)
 {
-	wxString tuple = "";
-	tuple += _token_set.GetStringFor (t0);
-	tuple += " " + _token_set.GetStringFor (t1);
-	tuple += " " + _token_set.GetStringFor (t2);
-	
-	return tuple;
+	_signatures.SetNumHashes (num_hashes);
 }
 
-wxSortedArrayString DocumentList::CollectMatchingTrigrams (int doc1, int doc2, bool unique, bool ignore) 
+bool DocumentList::IsApproximate () const
 {
-	return _tuple_set.CollectMatchingTuples (doc1, doc2, _token_set, unique, ignore);
+	return _signatures.GetNumHashes () > 0 && _num_bands == 0;
 }
 
-// make names of comparison structure visible
-DocumentList * DocumentList::uniquecountcmp::doclist;
-struct DocumentList::uniquecountcmp DocumentList::GetUniqueCountComparer ()
+void DocumentList::SetWinnowing (int window)
 {
-  uniquecountcmp comparer;
-  comparer.doclist = this;
-
-  return comparer;
+	_winnow_window = (window < 0 ? 0 : window);
 }
 
-// make names of comparison structure visible
-DocumentList * DocumentList::engagementcountcmp::doclist;
-struct DocumentList::engagementcountcmp DocumentList::GetEngagementCountComparer ()
+int DocumentList::GetWinnowing () const
 {
-  engagementcountcmp comparer;
-  comparer.doclist = this;
-
-  return comparer;
+	return _winnow_window;
 }
 
-// make names of comparison structure visible
-DocumentList * DocumentList::similaritycmp::doclist;
-std::vector<int> * DocumentList::similaritycmp::document1;
-std::vector<int> * DocumentList::similaritycmp::document2;
-
-struct DocumentList::similaritycmp DocumentList::GetSimilarityComparer (std::vector<int> * document1, std::vector<int> * document2, bool unique, bool ignore)
+void DocumentList::SetCandidateBands (int num_bands)
 {
-	similaritycmp comparer (unique, ignore);
-	comparer.doclist = this;
-	comparer.document1 = document1;
-	comparer.document2 = document2;
+	_num_bands = (num_bands < 0 ? 0 : num_bands);
+}
 
-	return comparer;
+bool DocumentList::UsesCandidates () const
+{
+	return _num_bands > 0 && _signatures.GetNumHashes () > 0;
 }
 
-void DocumentList::SaveDocumentList (wxString path)
+void DocumentList::GetCandidatePairs (std::vector<int> & document1, std::vector<int> & document2) const
 {
-	wxFile file;
-	if (file.Open (path, wxFile::write))
+	document1.clear ();
+	document2.clear ();
+	for (int doc1 = 0, n = (int)_candidate_starts.size () - 1; doc1 < n; ++doc1)
 	{
-		file.Write (wxString::Format ("next-group-id\t%d\n", _last_group_id));
-		file.Write ("begin-documents\n");
-		for (unsigned int i = 0, n = _documents.size (); i < n; ++i)
+		for (int c = _candidate_starts[doc1]; c < _candidate_starts[doc1 + 1]; ++c)
 		{
-			_documents[i]->Save (file);
+			document1.push_back (doc1);
+			document2.push_back (_candidate_partners[c]);
 		}
-		file.Write ("end-documents\n");
-
-		file.Write ("begin-tokens\n");
-		_token_set.Save (file);
-		file.Write ("end-tokens\n");
-
-		file.Write ("begin-tuples\n");
-		_tuple_set.Save (file);
-		file.Write ("end-tuples\n");
-
-
-		file.Close ();
 	}
 }
 
-// Read definition of document list from file.
-// -- return false if there is any error
-bool DocumentList::RetrieveDocumentList (wxString path) 
+// -- true if the two files hold the same bytes, checked after their hashes match
+static bool sameContents (wxString path1, wxString path2)
 {
-	if (!(wxFile::Exists (path))) return false;
+	wxFile file1 (path1);
+	wxFile file2 (path2);
+	if (!file1.IsOpened () || !file2.IsOpened ()) return false;
+	std::vector<char> buffer1 (65536);
+	std::vector<char> buffer2 (65536);
+	while (true)
+	{
+		ssize_t read1 = file1.Read (&buffer1[0], buffer1.size ());
+		ssize_t read2 = file2.Read (&buffer2[0], buffer2.size ());
+		if (read1 != read2 || read1 < 0) return false;
+		if (read1 == 0) return true;
+		if (memcmp (&buffer1[0], &buffer2[0], read1) != 0) return false;
+	}
+}
+
+// Find the documents from first_document which hold the same bytes as an
+// earlier one, and are read with the same reader: these have the same 
+// trigrams, so only the first is read and holds the trigrams, standing for 
+// all its copies, and ComputeAllSimilarities copies its results to them
+// -- only files whose size matches another's are hashed, and files with the
+//    same hash are compared, so different files are never taken as copies
+// -- template material, and documents not read as plain files, are always read
+// -- the copies are added to the tuples when they are needed one by one, 
+//    see ExpandDuplicates
+void DocumentList::FindDuplicates (int first_document)
+{
+	ExpandDuplicates ();
+	std::map<wxULongLong, std::vector<int> > same_size;
+	for (int i = first_document, n = _documents.size (); i < n; ++i)
+	{
+		if (_table.GetGroupId (i) == 0 || !_documents[i]->IsPlainFile ()) continue;
+		wxULongLong size = wxFileName::GetSize (_documents[i]->GetPathname ());
+		if (size != wxInvalidSize) same_size[size].push_back (i);
+	}
+	for (std::map<wxULongLong, std::vector<int> >::const_iterator it = same_size.begin (); 
+			it != same_size.end (); ++it)
+	{
+		const std::vector<int> & candidates = it->second;
+		if (candidates.size () < 2) continue;
+		std::map<wxString, std::vector<int> > originals; // -- by reader and hash
+		for (int k = 0, n = candidates.size (); k < n; ++k)
+		{
+			int i = candidates[k];
+			wxUint64 hash;
+			wxUint64 length;
+			if (!ContentHash::HashFile (_documents[i]->GetPathname (), hash, length)) continue;
+			wxString key = _documents[i]->GetReaderName () + wxString::Format ("-%08x%08x", 
+					(unsigned int)(hash >> 32), (unsigned int)(hash & 0xFFFFFFFF));
+			std::vector<int> & earlier = originals[key];
+			bool found = false;
+			for (int j = 0, m = earlier.size (); j < m && !found; ++j)
+			{
+				if (sameContents (_documents[earlier[j]]->GetPathname (), _documents[i]->GetPathname ()))
+				{
+					_duplicate_of[i] = earlier[j];
+					found = true;
+				}
+			}
+			if (!found) earlier.push_back (i);
+		}
+	}
+}
+
+bool DocumentList::IsDuplicate (int i) const
+{
+	return _duplicate_of.count (i) > 0;
+}
+
+int DocumentList::CountDuplicates () const
+{
+	return _duplicate_of.size ();
+}
+
+// Add each copy to the tuples of the document it copies, so the tuples hold
+// every document, e.g. to list or store them, or compare two documents
+void DocumentList::ExpandDuplicates ()
+{
+	if (_duplicate_of.empty ()) return;
+	std::map<int, std::vector<int> > copies;
+	for (std::map<int, int>::const_iterator it = _duplicate_of.begin (); it != _duplicate_of.end (); ++it)
+	{
+		copies[it->second].push_back (it->first);
+	}
+	_tuple_set.AddCopies (copies);
+	_duplicate_of.clear ();
+}
+
+// Set up the match storage for a new run of ComputeSimilarities
+// -- unique and engagement counts are recomputed, so are reset
+// -- group x group totals are only stored when grouping, as otherwise 
+//    each document is its own group
+// -- in approximate mode, matches are estimated when asked for, so none are stored,
+//    and when using candidates, matches are only stored for the candidates
+void DocumentList::ClearSimilarities ()
+{
+	int num_docs = _documents.size ();
+	_matches.clear ();
+	_candidate_starts.clear ();
+	_candidate_partners.clear ();
+	if (!IsApproximate () && !UsesCandidates ()) _matches.assign (num_docs * num_docs, MatchData ());
+	_table.ResetComparisonCounts ();
+	_num_compared_documents = 0;
+	_group_matches.clear ();
+	if (IsGrouped ())
+	{
+		int num_groups = _last_group_id + 1;
+		_group_matches.assign (num_groups * num_groups, MatchData ());
+	}
+}
+
+// Compute similarities for all pairs of documents.
+// -- if similarities are known for the first documents, e.g. from stored data,
+//    only the trigrams of documents added since are looked at, and if there are 
+//    no new documents the similarities are used as they are
+// -- in approximate mode, only the group totals are found, from the signatures
+// -- when using candidates, all the similarities are found again, as the 
+//    candidates change with the new documents
+void DocumentList::ComputeSimilarities ()
+{
+	int num_docs = _documents.size ();
+	_tuple_set.Freeze (); // -- compact the tuples read, before going through them
+	if (IsApproximate ())
+	{
+		ClearSimilarities ();
+		ComputeGroupMatches ();
+	}
+	else if (UsesCandidates ())
+	{
+		ComputeCandidateSimilarities ();
+	}
+	else if (_num_compared_documents == 0 || _num_compared_documents > num_docs)
+	{
+		ComputeAllSimilarities ();
+	}
+	else 
+	{
+		ExpandDuplicates (); // -- the earlier documents are counted one by one
+		if (_num_compared_documents < num_docs)
+		{
+			ExtendSimilarities (_num_compared_documents);
+		}
+		ComputeGroupMatches ();
+	}
+	_num_compared_documents = num_docs;
+	ComputeGroupTotals ();
+	_has_statistics = false; // -- see GetStatistics
+}
+
+// -- a document with duplicates stands for all its copies: a tuple holding it
+//    is counted as held by each copy, and the matches of each of its pairs,
+//    and with itself, are found once and copied to the pairs of copies, 
+//    see CopyDuplicateMatches
+void DocumentList::ComputeAllSimilarities ()
+{
+	ClearSimilarities ();
+	int num_docs = _documents.size ();
+	int num_groups = _last_group_id + 1;
+	bool grouped = !_group_matches.empty ();
+	const std::vector<int> & group_ids = _table.GetGroupIds ();
+	bool has_duplicates = !_duplicate_of.empty ();
+	std::vector<int> num_copies; // -- documents each document stands for, if there are duplicates
+	std::vector<MatchData> self_matches; // -- matches of a document with its own copies
+	if (has_duplicates)
+	{
+		num_copies.assign (num_docs, 1);
+		self_matches.assign (num_docs, MatchData ());
+		for (std::map<int, int>::const_iterator it = _duplicate_of.begin (); it != _duplicate_of.end (); ++it)
+		{
+			num_copies[it->second] += 1;
+		}
+	}
+	for (_tuple_set.Begin (); _tuple_set.HasMore (); _tuple_set.GetNext ())
+	{
+		const std::vector<int> & fvector = _tuple_set.GetDocumentsForCurrentTuple ();
+		int num_holding = fvector.size ();
+		if (has_duplicates)
+		{
+			num_holding = 0;
+			for (int i = 0; i < fvector.size (); i += 1) num_holding += num_copies[fvector[i]];
+		}
+    bool templateMaterial = CountTuple (fvector, num_holding);
+
+		// take each pair of documents in the vector, and add one to matches
+		// -- pairs in the same group are never displayed, so are skipped, 
+		//    except where a document's copies may be in other groups
+		bool is_unique = (num_holding == 2);
+		for (unsigned int fi = 0, n = fvector.size (); fi < n; ++fi)
+		{
+			int group1 = group_ids[fvector[fi]];
+			bool copied1 = has_duplicates && num_copies[fvector[fi]] > 1;
+			if (copied1)
+			{
+				self_matches[fvector[fi]].AddMatch (is_unique, templateMaterial);
+			}
+			for (unsigned int fj=fi+1; fj < n; ++fj)
+			{
+				int group2 = group_ids[fvector[fj]];
+				bool copied = copied1 || (has_duplicates && num_copies[fvector[fj]] > 1);
+				if (group1 == group2 && !copied) continue;
+				// ensure that first index is smaller than the second
+				int doc1 = std::min (fvector[fi], fvector[fj]);
+				int doc2 = std::max (fvector[fi], fvector[fj]);
+        int matchIndex = doc1 * num_docs + doc2;
+				assert (matchIndex < _matches.size());
+				_matches[matchIndex].AddMatch (is_unique, templateMaterial);
+				if (grouped && !copied)
+				{
+					int groupIndex = std::min (group1, group2) * num_groups + std::max (group1, group2);
+					_group_matches[groupIndex].AddMatch (is_unique, templateMaterial);
+				}
+			}
+		}
+
+	}
+	if (has_duplicates) CopyDuplicateMatches (self_matches);
+}
+
+// Count a tuple, held by the documents in fvector and num_holding documents
+// in all, in the unique and engagement counts of its documents
+// -- returns true if the tuple is in template material
+bool DocumentList::CountTuple (const std::vector<int> & fvector, int num_holding)
+{
+  const std::vector<int> & group_ids = _table.GetGroupIds ();
+    // if fvector is only size 1, then that tuple is unique to the document
+    // so keep track of the number of unique tuples
+    if (num_holding == 1) 
+    {
+      _table.IncrementUniqueCount (fvector[0]);
+    }
+    // if any of the files is id = 0 then the tuple is contained in template material
+    bool templateMaterial = false;
+    for (int i = 0; i < fvector.size (); i += 1)
+    {
+      if (group_ids[fvector[i]] == 0)
+      {
+        templateMaterial = true;
+        break;
+      }
+    }
+    // for template material, increase EngagementCount for all other documents
+    if (templateMaterial)
+    {
+      for (int i = 0; i < fvector.size (); i += 1)
+      {
+        if (group_ids[fvector[i]] != 0)
+        {
+          _table.IncrementEngagementCount (fvector[i]);
+        }
+      }
+    }
+  return templateMaterial;
+}
+
+// Compute similarities for the candidate pairs found from the signatures
+// -- the pairs of each tuple are found from the candidates of its documents,
+//    so a tuple held by many documents costs only as much as their candidates
+// -- copies are compared as documents in their own right
+void DocumentList::ComputeCandidateSimilarities ()
+{
+	ExpandDuplicates ();
+	ClearSimilarities ();
+	FindCandidates ();
+	int num_docs = _documents.size ();
+	int num_groups = _last_group_id + 1;
+	bool grouped = !_group_matches.empty ();
+	const std::vector<int> & group_ids = _table.GetGroupIds ();
+	std::vector<int> in_tuple (num_docs, -1); // -- number of the last tuple holding each document
+	int tuple = 0;
+	for (_tuple_set.Begin (); _tuple_set.HasMore (); _tuple_set.GetNext (), ++tuple)
+	{
+		const std::vector<int> & fvector = _tuple_set.GetDocumentsForCurrentTuple ();
+		bool templateMaterial = CountTuple (fvector, fvector.size ());
+		bool is_unique = (fvector.size () == 2);
+		for (unsigned int fi = 0, n = fvector.size (); fi < n; ++fi)
+		{
+			in_tuple[fvector[fi]] = tuple;
+		}
+		for (unsigned int fi = 0, n = fvector.size (); fi < n; ++fi)
+		{
+			int doc1 = fvector[fi];
+			for (int c = _candidate_starts[doc1]; c < _candidate_starts[doc1 + 1]; ++c)
+			{
+				int doc2 = _candidate_partners[c];
+				if (in_tuple[doc2] != tuple) continue;
+				_matches[c].AddMatch (is_unique, templateMaterial);
+				if (grouped)
+				{
+					int group1 = group_ids[doc1];
+					int group2 = group_ids[doc2];
+					int groupIndex = std::min (group1, group2) * num_groups + std::max (group1, group2);
+					_group_matches[groupIndex].AddMatch (is_unique, templateMaterial);
+				}
+			}
+		}
+	}
+}
+
+// Find the candidate pairs, in different groups, from the signatures of 
+// the documents with trigrams, and make space for their matches
+void DocumentList::FindCandidates ()
+{
+	int num_docs = _documents.size ();
+	const std::vector<int> & group_ids = _table.GetGroupIds ();
+	std::vector<int> documents;
+	for (int i = 0; i < num_docs; ++i)
+	{
+		if (_table.GetTrigramCount (i) > 0) documents.push_back (i);
+	}
+	std::vector<wxUint64> pairs;
+	_signatures.FindCandidatePairs (_num_bands, documents, pairs);
+	// -- the pairs are sorted, so each document's partners are together, in order
+	_candidate_starts.assign (num_docs + 1, 0);
+	_candidate_partners.clear ();
+	for (std::size_t k = 0, n = pairs.size (); k < n; ++k)
+	{
+		int doc1 = (int)(pairs[k] >> 32);
+		int doc2 = (int)(pairs[k] & 0xFFFFFFFF);
+		if (group_ids[doc1] == group_ids[doc2]) continue;
+		_candidate_starts[doc1 + 1] += 1;
+		_candidate_partners.push_back (doc2);
+	}
+	for (int i = 0; i < num_docs; ++i)
+	{
+		_candidate_starts[i + 1] += _candidate_starts[i];
+	}
+	_matches.assign (_candidate_partners.size (), MatchData ());
+}
+
+// the index of the candidate pair doc1, doc2 in _matches, or -1 if not a candidate
+int DocumentList::FindCandidate (int doc1, int doc2) const
+{
+	if (doc1 + 1 >= (int)_candidate_starts.size ()) return -1;
+	std::vector<int>::const_iterator first = _candidate_partners.begin () + _candidate_starts[doc1];
+	std::vector<int>::const_iterator last = _candidate_partners.begin () + _candidate_starts[doc1 + 1];
+	std::vector<int>::const_iterator found = std::lower_bound (first, last, doc2);
+	if (found == last || * found != doc2) return -1;
+	return found - _candidate_partners.begin ();
+}
+
+// Give each copy of a document the counts and matches found for the document
+// -- the matches found for a pair of documents, either with copies, are 
+//    copied to every pair of their copies in different groups, and cleared 
+//    if the documents themselves are in the same group
+// -- no tuple is unique to a document with copies, and copies are never 
+//    template material, so their engagement counts are those of the document
+void DocumentList::CopyDuplicateMatches (const std::vector<MatchData> & self_matches)
+{
+	int num_docs = _documents.size ();
+	int num_groups = _last_group_id + 1;
+	bool grouped = !_group_matches.empty ();
+	const std::vector<int> & group_ids = _table.GetGroupIds ();
+	// -- copies[i] holds document i and its copies, if it has any
+	std::vector<std::vector<int> > copies (num_docs);
+	std::vector<bool> is_copy (num_docs, false);
+	for (std::map<int, int>::const_iterator it = _duplicate_of.begin (); it != _duplicate_of.end (); ++it)
+	{
+		is_copy[it->first] = true;
+		if (copies[it->second].empty ()) copies[it->second].push_back (it->second);
+		copies[it->second].push_back (it->first);
+		_table.SetEngagementCount (it->first, _table.GetEngagementCount (it->second));
+	}
+	std::vector<int> single (1);
+	for (int doc1 = 0; doc1 < num_docs; ++doc1)
+	{
+		if (copies[doc1].empty ()) continue;
+		for (int doc2 = 0; doc2 < num_docs; ++doc2)
+		{
+			if (is_copy[doc2]) continue; // -- a copy, not a document read
+			if (doc2 < doc1 && !copies[doc2].empty ()) continue; // -- pair already copied
+			MatchData match = (doc1 == doc2 ? self_matches[doc1] : _matches[std::min (doc1, doc2) * num_docs + std::max (doc1, doc2)]);
+			if (doc1 != doc2 && group_ids[doc1] == group_ids[doc2])
+			{
+				_matches[std::min (doc1, doc2) * num_docs + std::max (doc1, doc2)] = MatchData ();
+			}
+			single[0] = doc2;
+			const std::vector<int> & copies2 = (copies[doc2].empty () ? single : copies[doc2]);
+			for (int i = 0, n = copies[doc1].size (); i < n; ++i)
+			{
+				for (int j = 0, m = copies2.size (); j < m; ++j)
+				{
+					int copy1 = copies[doc1][i];
+					int copy2 = copies2[j];
+					if (copy1 >= copy2 && doc1 == doc2) continue; // -- each pair of copies once
+					int group1 = group_ids[copy1];
+					int group2 = group_ids[copy2];
+					if (group1 == group2) continue;
+					_matches[std::min (copy1, copy2) * num_docs + std::max (copy1, copy2)] = match;
+					if (grouped)
+					{
+						int groupIndex = std::min (group1, group2) * num_groups + std::max (group1, group2);
+						_group_matches[groupIndex].Add (match);
+					}
+				}
+			}
+		}
+	}
+}
+
+// Add the documents from first_new onwards to the similarities already 
+// computed for the documents before them.
+// Only tuples containing a new document are looked at: these add matches for
+// pairs with the new documents, and may change how the tuple was counted for 
+// the earlier documents, as it is no longer unique to them, or is now 
+// in template material.
+void DocumentList::ExtendSimilarities (int first_new)
+{
+	int num_docs = _documents.size ();
+	// -- move the earlier matches into a table sized for all the documents
+	std::vector<MatchData> matches (num_docs * num_docs, MatchData ());
+	for (int doc1 = 0; doc1 < first_new; ++doc1)
+	{
+		std::copy (_matches.begin () + doc1 * first_new, 
+				_matches.begin () + (doc1 + 1) * first_new,
+				matches.begin () + doc1 * num_docs);
+	}
+	_matches.swap (matches);
+
+	const std::vector<int> & group_ids = _table.GetGroupIds ();
+	for (_tuple_set.Begin (); _tuple_set.HasMore (); _tuple_set.GetNext ())
+	{
+		const std::vector<int> & fvector = _tuple_set.GetDocumentsForCurrentTuple ();
+		int num_old = 0;
+		int last_old = 0;
+		bool was_template = false; // -- tuple was in template material of earlier documents
+		bool is_template = false;
+		for (unsigned int i = 0, n = fvector.size (); i < n; ++i)
+		{
+			bool in_template = (group_ids[fvector[i]] == 0);
+			if (fvector[i] < first_new)
+			{
+				num_old += 1;
+				last_old = fvector[i];
+				was_template = was_template || in_template;
+			}
+			is_template = is_template || in_template;
+		}
+		if (num_old == (int)fvector.size ()) continue; // no new documents, so nothing changes
+
+		// -- unique counts
+		if (num_old == 1)
+		{
+			_table.DecrementUniqueCount (last_old);
+		}
+		if (fvector.size () == 1)
+		{
+			_table.IncrementUniqueCount (fvector[0]);
+		}
+		// -- engagement counts, for documents not already counted
+		if (is_template)
+		{
+			for (unsigned int i = 0, n = fvector.size (); i < n; ++i)
+			{
+				if (group_ids[fvector[i]] != 0 && (!was_template || fvector[i] >= first_new))
+				{
+					_table.IncrementEngagementCount (fvector[i]);
+				}
+			}
+		}
+		// -- pairs of documents, recounting pairs of earlier documents if needed
+		bool was_unique = (num_old == 2);
+		bool is_unique = (fvector.size () == 2);
+		bool recount = (was_unique != is_unique || was_template != is_template);
+		for (unsigned int fi = 0, n = fvector.size (); fi < n; ++fi)
+		{
+			int group1 = group_ids[fvector[fi]];
+			for (unsigned int fj = fi+1; fj < n; ++fj)
+			{
+				int group2 = group_ids[fvector[fj]];
+				if (group1 == group2) continue;
+				int doc1 = std::min (fvector[fi], fvector[fj]);
+				int doc2 = std::max (fvector[fi], fvector[fj]);
+				MatchData & match = _matches[doc1 * num_docs + doc2];
+				if (doc2 >= first_new)
+				{
+					match.AddMatch (is_unique, is_template);
+				}
+				else if (recount)
+				{
+					match.RemoveMatch (was_unique, was_template);
+					match.AddMatch (is_unique, is_template);
+				}
+			}
+		}
+	}
+}
+
+// Sum the matches of each pair of documents into their groups, 
+// when the group totals were not found with the pairs
+void DocumentList::ComputeGroupMatches ()
+{
+	_group_matches.clear ();
+	if (!IsGrouped ()) return;
+
+	int num_docs = _documents.size ();
+	int num_groups = _last_group_id + 1;
+	_group_matches.assign (num_groups * num_groups, MatchData ());
+	const std::vector<int> & group_ids = _table.GetGroupIds ();
+	for (int doc1 = 0; doc1 < num_docs; ++doc1)
+	{
+		for (int doc2 = doc1 + 1; doc2 < num_docs; ++doc2)
+		{
+			int group1 = group_ids[doc1];
+			int group2 = group_ids[doc2];
+			if (group1 == group2) continue;
+			int groupIndex = std::min (group1, group2) * num_groups + std::max (group1, group2);
+			_group_matches[groupIndex].Add (GetMatchData (doc1, doc2));
+		}
+	}
+}
+
+// Sum the unique and engagement counts for each group, and count the pairs,
+// so the views can look these up when sorting
+// -- groups are indexed as in GetGroupName, i.e. by group id - 1
+void DocumentList::ComputeGroupTotals ()
+{
+	_group_unique_counts.clear ();
+	_group_engagement_counts.clear ();
+	if (IsGrouped ())
+	{
+		_group_unique_counts.assign (_last_group_id, 0);
+		_group_engagement_counts.assign (_last_group_id, 0);
+		for (int i = 0, n = _table.Size (); i < n; ++i)
+		{
+			int index = _table.GetGroupId (i) - 1;
+			if (index < 0 || index >= _last_group_id) continue; // template material
+			_group_unique_counts[index] += _table.GetUniqueCount (i);
+			_group_engagement_counts[index] += _table.GetEngagementCount (i);
+		}
+	}
+	_num_pairs = CountPairs ();
+}
+
+// the resemblance of two documents with num_trigrams between them, num_matches shared
+static float resemblance (int num_matches, int num_trigrams)
+{
+	float total_trigrams = (float)num_trigrams - (float)num_matches;
+	if (total_trigrams == 0.0) return 0.0; // check for divide by zero
+	return (float)num_matches/total_trigrams;
+}
+
+// Collect the similarity of every displayed pair, i.e. those in different groups,
+// under each of the four similarity measures
+// -- when using candidates, only the candidates are looked at, and every other
+//    pair has a similarity of 0
+void DocumentList::ComputeStatistics ()
+{
+	_statistics.Clear ();
+	if (UsesCandidates ())
+	{
+		std::vector<int> document1;
+		std::vector<int> document2;
+		GetCandidatePairs (document1, document2);
+		for (int i = 0, n = document1.size (); i < n; ++i)
+		{
+			AddPairStatistics (document1[i], document2[i]);
+		}
+		int num_others = NumberOfPairs () - document1.size ();
+		for (int k = 0; k < 4; ++k)
+		{
+			_statistics.GetSummary (k & 1, k & 2).AddScore (0.0, num_others);
+		}
+		return;
+	}
+	const std::vector<int> & group_ids = _table.GetGroupIds ();
+	for (int i = 0, n = group_ids.size (); i < n; ++i)
+		for (int j = i+1; j < n; ++j)
+		{
+			if (group_ids[i] != group_ids[j]) AddPairStatistics (i, j);
+		}
+}
+
+// -- the matches of the pair are looked up once, for all four measures
+// -- in approximate mode, the four measures are the same estimate, found once
+void DocumentList::AddPairStatistics (int doc1, int doc2)
+{
+	if (IsApproximate ())
+	{
+		float estimate = ComputeResemblance (doc1, doc2);
+		for (int k = 0; k < 4; ++k) _statistics.GetSummary (k & 1, k & 2).AddScore (estimate);
+		return;
+	}
+	MatchData match = GetMatchData (doc1, doc2);
+	int num_trigrams = CountTrigrams (doc1) + CountTrigrams (doc2);
+	for (int k = 0; k < 4; ++k)
+	{
+		bool unique = (k & 1);
+		bool ignore = (k & 2);
+		_statistics.GetSummary (unique, ignore).AddScore (resemblance (match.GetCount (unique, ignore), num_trigrams));
+	}
+}
+
+const CorpusStatistics & DocumentList::GetStatistics ()
+{
+	if (!_has_statistics)
+	{
+		ComputeStatistics ();
+		_has_statistics = true;
+	}
+	return _statistics;
+}
+
+int DocumentList::GetTotalTrigramCount ()
+{
+	return _tuple_set.Size ();
+}
+
+// return a count of the trigrams in document i
+int DocumentList::CountTrigrams (int doc_i) 
+{
+ return _table.GetTrigramCount (doc_i);
+}
+
+int DocumentList::CountMatches (int doc_i, int doc_j, bool unique, bool ignore_template)
+{
+	assert (doc_j > doc_i); // _matches is only completed from one side, with doc_j > doc_i
+	return GetMatchData (doc_i, doc_j).GetCount (unique, ignore_template);
+}
+
+// the matches of a pair of documents, with doc1 < doc2
+// -- in approximate mode, the count of shared trigrams m is estimated from 
+//    the resemblance R = m / (a + b - m) of documents with a and b trigrams,
+//    as m = R (a + b) / (1 + R), and given for every measure, as neither 
+//    unique trigrams nor template material are known without the index
+// -- when using candidates, pairs not found as candidates have no matches
+MatchData DocumentList::GetMatchData (int doc1, int doc2) const
+{
+	if (IsApproximate ())
+	{
+		MatchData match;
+		int num_trigrams = _table.GetTrigramCount (doc1) + _table.GetTrigramCount (doc2);
+		if (_table.GetTrigramCount (doc1) > 0 && _table.GetTrigramCount (doc2) > 0)
+		{
+			float resemblance = _signatures.EstimateResemblance (doc1, doc2);
+			int estimate = (int)(resemblance * num_trigrams / (1.0 + resemblance) + 0.5);
+			match.common = match.unique = match.ignore = match.unique_ignore = estimate;
+		}
+		return match;
+	}
+	if (UsesCandidates ())
+	{
+		int candidate = FindCandidate (doc1, doc2);
+		return (candidate < 0 ? MatchData () : _matches[candidate]);
+	}
+	int matchIndex = doc1 * _documents.size() + doc2;
+	assert (matchIndex < _matches.size());
+	return _matches[matchIndex];
+}
+
+// -- in approximate mode, the estimate from the signatures, for every measure
+float DocumentList::ComputeResemblance (int doc_i, int doc_j, bool unique, bool ignore)
+{
+	if (IsApproximate ())
+	{
+		if (CountTrigrams (doc_i) == 0 || CountTrigrams (doc_j) == 0) return 0.0;
+		return _signatures.EstimateResemblance (doc_i, doc_j);
+	}
+	return resemblance (CountMatches (doc_i, doc_j, unique, ignore), CountTrigrams (doc_i) + CountTrigrams (doc_j));
+}
+
+float DocumentList::ComputeContainment (int doc_i, int doc_j, bool unique, bool ignore)
+{
+	float num_matches = (float)(doc_j > doc_i ? CountMatches (doc_i, doc_j, unique, ignore) : CountMatches (doc_j, doc_i, unique, ignore));
+	float target_trigrams = (float)(CountTrigrams (doc_j));
+	if (target_trigrams == 0.0) return 0.0; // check for divide by zero
+	return num_matches/target_trigrams;
+}
+
+// unique count is the total of counts for files in given group index,
+// as kept by ComputeGroupTotals, or document's unique count if no groups used.
+int DocumentList::UniqueCount (int index) const
+{
+  if (IsGrouped ())
+  {
+    if (index >= _group_unique_counts.size ()) return 0; // not yet computed
+    return _group_unique_counts[index];
+  }
+  else
+  {
+    return _table.GetUniqueCount (index);
+  }
+}
+
+// engagement count is the total of counts for files in given group index,
+// as kept by ComputeGroupTotals, or document's count if no groups used.
+int DocumentList::EngagementCount (int index) const
+{
+  if (IsGrouped ())
+  {
+    if (index >= _group_engagement_counts.size ()) return 0; // not yet computed
+    return _group_engagement_counts[index];
+  }
+  else
+  {
+    return _table.GetEngagementCount (index);
+  }
+}
+
+// count the matches between every pair of documents in the two groups,
+// where groups are indexed as in GetGroupName
+// -- only available when documents are grouped, returns 0 otherwise
+int DocumentList::CountGroupMatches (int group_i, int group_j, bool unique, bool ignore) const
+{
+  if (_group_matches.empty ()) return 0;
+
+  int num_groups = _last_group_id + 1;
+  int id_i = group_i + 1; // index == 0 special role
+  int id_j = group_j + 1;
+  int groupIndex = std::min (id_i, id_j) * num_groups + std::max (id_i, id_j);
+  assert (groupIndex < _group_matches.size ());
+  return _group_matches[groupIndex].GetCount (unique, ignore);
+}
+
+bool DocumentList::IsMatchingTrigram (std::size_t t0, std::size_t t1, std::size_t t2, int doc1, int doc2, bool unique, bool ignore)
+{
+	ExpandDuplicates ();
+	return _tuple_set.IsMatchingTuple (t0, t1, t2, doc1, doc2, unique, ignore);
+}
+
+bool DocumentList::IsTemplateTrigram (std::size_t t0, std::size_t t1, std::size_t t2)
+{
+  return _tuple_set.IsTemplateTuple (t0, t1, t2);
+}
+
+wxString DocumentList::MakeTrigramString (std::size_t t0, std::size_t t1, std::size_t t2)
+{
+	wxString tuple = "";
+	tuple += _token_set.GetStringFor (t0);
+	tuple += " " + _token_set.GetStringFor (t1);
+	tuple += " " + _token_set.GetStringFor (t2);
 	
+	return tuple;
+}
+
+wxSortedArrayString DocumentList::CollectMatchingTrigrams (int doc1, int doc2, bool unique, bool ignore) 
+{
+	ExpandDuplicates ();
+	return _tuple_set.CollectMatchingTuples (doc1, doc2, _token_set, unique, ignore);
+}
+
+// make names of comparison structure visible
+DocumentList * DocumentList::uniquecountcmp::doclist;
+struct DocumentList::uniquecountcmp DocumentList::GetUniqueCountComparer ()
+{
+  uniquecountcmp comparer;
+  comparer.doclist = this;
+
+  return comparer;
+}
+
+// make names of comparison structure visible
+DocumentList * DocumentList::engagementcountcmp::doclist;
+struct DocumentList::engagementcountcmp DocumentList::GetEngagementCountComparer ()
+{
+  engagementcountcmp comparer;
+  comparer.doclist = this;
+
+  return comparer;
+}
+
+// make names of comparison structure visible
+DocumentList * DocumentList::similaritycmp::doclist;
+std::vector<int> * DocumentList::similaritycmp::document1;
+std::vector<int> * DocumentList::similaritycmp::document2;
+
+struct DocumentList::similaritycmp DocumentList::GetSimilarityComparer (std::vector<int> * document1, std::vector<int> * document2, bool unique, bool ignore)
+{
+	similaritycmp comparer (unique, ignore);
+	comparer.doclist = this;
+	comparer.document1 = document1;
+	comparer.document2 = document2;
+
+	return comparer;
+}
+
+// section tags for stored data, see binaryio.h for the file layout
+const wxUint32 DOCUMENTS_SECTION = MakeSectionTag ('D', 'O', 'C', 'S');
+const wxUint32 TOKENS_SECTION = MakeSectionTag ('T', 'O', 'K', 'S');
+const wxUint32 TUPLES_SECTION = MakeSectionTag ('T', 'U', 'P', 'S');
+const wxUint32 SIMILARITIES_SECTION = MakeSectionTag ('S', 'I', 'M', 'S');
+
+// Save document list in binary format, as sections for documents, tokens and tuples
+// -- if the similarities have been computed for all documents, these are saved too,
+//    unless they are estimated or kept only for candidates, see WriteSimilarities
+void DocumentList::SaveDocumentList (wxString path)
+{
+	ExpandDuplicates ();
+	wxFile file;
+	if (file.Open (path, wxFile::write))
+	{
+		bool has_similarities = (_num_compared_documents > 0 && _num_compared_documents == Size () &&
+				!IsApproximate () && !UsesCandidates ());
+		BinaryWriter output (file);
+		output.WriteHeader (has_similarities ? 4 : 3);
+
+		output.BeginSection (DOCUMENTS_SECTION);
+		WriteDocumentDefinitions (output);
+		output.EndSection ();
+
+		output.BeginSection (TOKENS_SECTION);
+		_token_set.Save (output);
+		output.EndSection ();
+
+		output.BeginSection (TUPLES_SECTION);
+		_tuple_set.Save (output);
+		output.EndSection ();
+
+		if (has_similarities)
+		{
+			output.BeginSection (SIMILARITIES_SECTION);
+			WriteSimilarities (output);
+			output.EndSection ();
+		}
+
+		output.Flush ();
+		file.Close ();
+	}
+}
+
+// -- only documents from first_document are written, and are appended when read
+void DocumentList::WriteDocumentDefinitions (BinaryWriter & output, int first_document)
+{
+	output.WriteVarint (_last_group_id);
+	output.WriteVarint (_documents.size () - first_document);
+	for (unsigned int i = first_document, n = _documents.size (); i < n; ++i)
+	{
+		output.WriteString (_documents[i]->GetPathname ());
+		output.WriteString (_documents[i]->GetOriginalPathname ());
+		output.WriteString (_table.GetName (i));
+		output.WriteVarint (_table.GetTrigramCount (i));
+		output.WriteVarint (_table.GetGroupId (i));
+	}
+}
+
+bool DocumentList::ReadDocumentDefinitions (BinaryReader & input)
+{
+	int num_documents;
+	if (!input.ReadVarint (_last_group_id)) return false;
+	if (!input.ReadVarint (num_documents)) return false;
+	for (int i = 0; i < num_documents; ++i)
+	{
+		wxString pathname;
+		wxString original_pathname;
+		wxString name;
+		int num_trigrams;
+		int id;
+		if (!input.ReadString (pathname)) return false;
+		if (!input.ReadString (original_pathname)) return false;
+		if (!input.ReadString (name)) return false;
+		if (!input.ReadVarint (num_trigrams)) return false;
+		if (!input.ReadVarint (id)) return false;
+
+		Document * doc = new Document (pathname);
+		doc->SetOriginalPathname (original_pathname);
+		AppendDocument (doc, id, name);
+		_table.SetTrigramCount (_table.Size () - 1, num_trigrams);
+		if (id == 0) _has_template_material = true;
+	}
+	return true;
+}
+
+// Write the unique and engagement counts of each document, and the matches
+// of each pair of documents which share any trigrams.
+// -- pairs are in order, with the first document as a difference from the
+//    previous pair's, and the second as a difference from the previous pair's 
+//    second document, or from the first document when that changes
+// -- _matches must hold every pair, so not in approximate mode or with candidates
+void DocumentList::WriteSimilarities (BinaryWriter & output)
+{
+	int num_docs = _documents.size ();
+	assert (_matches.size () == (std::size_t)num_docs * num_docs);
+	output.WriteVarint (num_docs);
+	for (int i = 0; i < num_docs; ++i)
+	{
+		output.WriteVarint (_table.GetUniqueCount (i));
+		output.WriteVarint (_table.GetEngagementCount (i));
+	}
+
+	int num_matches = 0;
+	for (int i = 0, n = _matches.size (); i < n; ++i)
+	{
+		if (_matches[i].common > 0) num_matches += 1;
+	}
+	output.WriteVarint (num_matches);
+	int last_doc1 = 0;
+	int last_doc2 = 0;
+	for (int doc1 = 0; doc1 < num_docs; ++doc1)
+	{
+		for (int doc2 = doc1 + 1; doc2 < num_docs; ++doc2)
+		{
+			const MatchData & match = _matches[doc1 * num_docs + doc2];
+			if (match.common == 0) continue;
+			if (doc1 != last_doc1) last_doc2 = doc1;
+			output.WriteVarint (doc1 - last_doc1);
+			output.WriteVarint (doc2 - last_doc2);
+			output.WriteVarint (match.common);
+			output.WriteVarint (match.unique);
+			output.WriteVarint (match.ignore);
+			output.WriteVarint (match.unique_ignore);
+			last_doc1 = doc1;
+			last_doc2 = doc2;
+		}
+	}
+}
+
+// -- must follow the documents section, and match its number of documents
+bool DocumentList::ReadSimilarities (BinaryReader & input)
+{
+	int num_docs;
+	if (!input.ReadVarint (num_docs) || num_docs != Size ()) return false;
+	for (int i = 0; i < num_docs; ++i)
+	{
+		int unique_count;
+		int engagement_count;
+		if (!input.ReadVarint (unique_count)) return false;
+		if (!input.ReadVarint (engagement_count)) return false;
+		_table.SetUniqueCount (i, unique_count);
+		_table.SetEngagementCount (i, engagement_count);
+	}
+
+	int num_matches;
+	if (!input.ReadVarint (num_matches)) return false;
+	_matches.assign (num_docs * num_docs, MatchData ());
+	int doc1 = 0;
+	int doc2 = 0;
+	for (int i = 0; i < num_matches; ++i)
+	{
+		int doc1_step;
+		int doc2_step;
+		if (!input.ReadVarint (doc1_step)) return false;
+		if (!input.ReadVarint (doc2_step)) return false;
+		if (doc1_step > 0) doc2 = doc1 + doc1_step;
+		doc1 += doc1_step;
+		doc2 += doc2_step;
+		if (doc2 <= doc1 || doc2 >= num_docs) return false;
+		MatchData & match = _matches[doc1 * num_docs + doc2];
+		if (!input.ReadVarint (match.common)) return false;
+		if (!input.ReadVarint (match.unique)) return false;
+		if (!input.ReadVarint (match.ignore)) return false;
+		if (!input.ReadVarint (match.unique_ignore)) return false;
+	}
+	_num_compared_documents = num_docs;
+	return true;
+}
+
+// Read definition of document list from file.
+// -- files in the binary format are recognised from their first bytes, 
+//    otherwise the file is read in the earlier text format
+// -- return false if there is any error
+bool DocumentList::RetrieveDocumentList (wxString path) 
+{
+	if (!(wxFile::Exists (path))) return false;
+
+	if (BinaryReader::IsBinaryFile (path))
+	{
+		return RetrieveBinaryDocumentList (path);
+	}
+	else
+	{
+		return RetrieveTextDocumentList (path);
+	}
+}
+
+// Save tokens, tuples and documents as an index, which can be opened with OpenIndex
+// -- must not be saved to the path of the currently open index
+bool DocumentList::SaveIndex (wxString path)
+{
+	ExpandDuplicates ();
+	wxFile file;
+	if (!file.Open (path, wxFile::write)) return false;
+	if (!MappedIndex::Write (file, _token_set, _tuple_set)) return false;
+
+	BinaryWriter output (file);
+	output.BeginSection (DOCUMENTS_SECTION);
+	WriteDocumentDefinitions (output);
+	output.EndSection ();
+	return output.Flush ();
+}
+
+// Replace current list with documents from the given index file.
+// The tokens and tuples are used from the mapped file, with new 
+// documents added to the maps held in memory.
+bool DocumentList::OpenIndex (wxString path)
+{
+	Clear ();
+	if (!_index.Open (path)) return false;
+
+	wxFile file;
+	bool ok = file.Open (path, wxFile::read) && 
+		file.Seek (_index.GetDocumentsPosition ()) != wxInvalidOffset;
+	if (ok)
+	{
+		BinaryReader input (file);
+		wxUint32 tag;
+		ok = input.BeginSection (tag) && 
+			tag == DOCUMENTS_SECTION &&
+			ReadDocumentDefinitions (input) &&
+			input.EndSection ();
+	}
+	if (!ok)
+	{
+		Clear ();
+		return false;
+	}
+	_token_set.SetBase (&_index);
+	_tuple_set.SetBase (&_index);
+	return true;
+}
+
+// -- sections with unknown tags are skipped
+// -- on any error, including a checksum which does not match, the list is left empty
+bool DocumentList::RetrieveBinaryDocumentList (wxString path)
+{
+	wxFile file;
+	if (!file.Open (path, wxFile::read)) return false;
+	BinaryReader input (file);
+
+	wxUint32 num_sections;
+	bool ok = input.ReadHeader (num_sections) && ReadSections (input, num_sections);
+
+	if (!ok) Clear ();
+	return ok;
+}
+
+bool DocumentList::ReadSections (BinaryReader & input, wxUint32 num_sections)
+{
+	bool ok = true;
+	for (wxUint32 i = 0; ok && i < num_sections; ++i)
+	{
+		wxUint32 tag;
+		ok = input.BeginSection (tag);
+		if (!ok) break;
+		if (tag == DOCUMENTS_SECTION)
+		{
+			ok = ReadDocumentDefinitions (input);
+		}
+		else if (tag == TOKENS_SECTION)
+		{
+			ok = _token_set.Load (input);
+		}
+		else if (tag == TUPLES_SECTION)
+		{
+			ok = _tuple_set.Load (input);
+		}
+		else if (tag == SIMILARITIES_SECTION)
+		{
+			ok = ReadSimilarities (input);
+		}
+		ok = ok && input.EndSection ();
+	}
+	return ok;
+}
+
+// *** Segmented store
+// Each segment is a file in the binary format, starting with a section giving
+// the first document and first token it holds.  A segment whose first document
+// is 0 holds the complete store, e.g. after compaction, and so replaces 
+// all segments before it.  
+// -- segments are numbered in order, and written to a temporary file 
+//    which is renamed when complete, so readers never see part of a segment
+// -- only one process should add segments at a time, but CompactSegments 
+//    can run while segments are added
+
+const wxUint32 SEGMENT_SECTION = MakeSectionTag ('S', 'E', 'G', 'M');
+
+static wxString SegmentPath (wxString directory, int number)
+{
+	return wxFileName (directory, wxString::Format ("segment-%08d.fds", number)).GetFullPath ();
+}
+
+static int SegmentNumber (wxString path)
+{
+	long number = 0;
+	wxFileName (path).GetName ().AfterFirst ('-').ToLong (&number);
+	return (int)number;
+}
+
+static wxString TemporarySegmentPath (wxString directory)
+{
+	return wxFileName (directory, wxString::Format ("segment-%lu.tmp", wxGetProcessId ())).GetFullPath ();
+}
+
+// segments in the directory, in order
+static void ListSegments (wxString directory, wxArrayString & segments)
+{
+	segments.Clear ();
+	if (wxFileName::DirExists (directory))
+	{
+		wxDir::GetAllFiles (directory, &segments, "segment-*.fds", wxDIR_FILES);
+		segments.Sort ();
+	}
+}
+
+static bool ReadSegmentHeader (BinaryReader & input, wxUint32 & num_sections, int & first_document, int & first_token)
+{
+	wxUint32 tag;
+	return input.ReadHeader (num_sections) &&
+		num_sections > 0 &&
+		input.BeginSection (tag) &&
+		tag == SEGMENT_SECTION &&
+		input.ReadVarint (first_document) &&
+		input.ReadVarint (first_token) &&
+		input.EndSection ();
+}
+
+// Replace current list with the documents held in the segments of the given directory.
+// -- a directory without segments gives an empty list
+// -- on any error, the list is left empty
+bool DocumentList::RetrieveSegments (wxString directory)
+{
+	wxArrayString segments;
+	return ReadSegments (directory, segments);
+}
+
+// read from the last complete segment onwards, returning the segments read
+bool DocumentList::ReadSegments (wxString directory, wxArrayString & segments)
+{
+	Clear ();
+	wxArrayString all_segments;
+	ListSegments (directory, all_segments);
+
+	int start = 0;
+	for (int i = all_segments.size () - 1; i > 0; --i)
+	{
+		wxFile file;
+		if (!file.Open (all_segments[i], wxFile::read)) continue;
+		BinaryReader input (file);
+		wxUint32 num_sections;
+		int first_document;
+		int first_token;
+		if (ReadSegmentHeader (input, num_sections, first_document, first_token) && first_document == 0)
+		{
+			start = i;
+			break;
+		}
+	}
+
+	segments.Clear ();
+	for (int i = start, n = all_segments.size (); i < n; ++i)
+	{
+		if (!ReadSegment (all_segments[i]))
+		{
+			Clear ();
+			return false;
+		}
+		segments.Add (all_segments[i]);
+	}
+	_num_segment_documents = Size ();
+	_num_segment_tokens = _token_set.Size ();
+	return true;
+}
+
+// -- the segment must start with the next document and token
+bool DocumentList::ReadSegment (wxString path)
+{
+	wxFile file;
+	if (!file.Open (path, wxFile::read)) return false;
+	BinaryReader input (file);
+	wxUint32 num_sections;
+	int first_document;
+	int first_token;
+	return ReadSegmentHeader (input, num_sections, first_document, first_token) &&
+		first_document == Size () &&
+		first_token == (int)_token_set.Size () &&
+		ReadSections (input, num_sections - 1);
+}
+
+// Write the documents, tokens and trigrams from the given first document and token.
+// -- a complete segment also holds the similarities, if computed for all documents
+bool DocumentList::WriteSegment (wxString path, int first_document, std::size_t first_token)
+{
+	wxFile file;
+	if (!file.Open (path, wxFile::write)) return false;
+	bool has_similarities = (first_document == 0 && 
+			_num_compared_documents > 0 && _num_compared_documents == Size () &&
+			!IsApproximate () && !UsesCandidates ());
+	BinaryWriter output (file);
+	output.WriteHeader (has_similarities ? 5 : 4);
+
+	output.BeginSection (SEGMENT_SECTION);
+	output.WriteVarint (first_document);
+	output.WriteVarint (first_token);
+	output.EndSection ();
+
+	output.BeginSection (DOCUMENTS_SECTION);
+	WriteDocumentDefinitions (output, first_document);
+	output.EndSection ();
+
+	output.BeginSection (TOKENS_SECTION);
+	_token_set.Save (output, first_token);
+	output.EndSection ();
+
+	output.BeginSection (TUPLES_SECTION);
+	_tuple_set.Save (output, first_document);
+	output.EndSection ();
+
+	if (has_similarities)
+	{
+		output.BeginSection (SIMILARITIES_SECTION);
+		WriteSimilarities (output);
+		output.EndSection ();
+	}
+
+	return output.Flush ();
+}
+
+// Add a segment with the documents, and their tokens and trigrams, 
+// which are not yet in the store.
+bool DocumentList::AppendSegment (wxString directory)
+{
+	ExpandDuplicates ();
+	if (Size () == _num_segment_documents) return true; // -- nothing new to store
+	if (!wxFileName::DirExists (directory) && !wxFileName::Mkdir (directory, 0777, wxPATH_MKDIR_FULL)) 
+	{
+		return false;
+	}
+
+	wxString temporary_path = TemporarySegmentPath (directory);
+	if (!WriteSegment (temporary_path, _num_segment_documents, _num_segment_tokens))
+	{
+		wxRemoveFile (temporary_path);
+		return false;
+	}
+	// -- take the next free number, in case the store changed since it was read
+	wxArrayString segments;
+	ListSegments (directory, segments);
+	int number = (segments.IsEmpty () ? 1 : SegmentNumber (segments.Last ()) + 1);
+	while (!wxRenameFile (temporary_path, SegmentPath (directory, number), false))
+	{
+		if (wxFileExists (SegmentPath (directory, number)))
+		{
+			number += 1;
+		}
+		else
+		{
+			wxRemoveFile (temporary_path);
+			return false;
+		}
+	}
+	_num_segment_documents = Size ();
+	_num_segment_tokens = _token_set.Size ();
+	return true;
+}
+
+// Merge the segments of the store into one complete segment, with the similarities
+// computed, which replaces the last segment read.  Earlier segments are then removed.
+// -- segments added while compacting come after the new segment, so are kept
+bool DocumentList::CompactSegments (wxString directory)
+{
+	wxArrayString segments;
+	if (!ReadSegments (directory, segments)) return false;
+	if (segments.size () < 2) return true; // -- already compact
+
+	ComputeSimilarities ();
+	wxString temporary_path = TemporarySegmentPath (directory);
+	if (!WriteSegment (temporary_path, 0, 0) || 
+			!wxRenameFile (temporary_path, segments.Last (), true))
+	{
+		wxRemoveFile (temporary_path);
+		return false;
+	}
+
+	wxArrayString all_segments;
+	ListSegments (directory, all_segments);
+	for (int i = 0, n = all_segments.size (); i < n; ++i)
+	{
+		if (SegmentNumber (all_segments[i]) < SegmentNumber (segments.Last ()))
+		{
+			wxRemoveFile (all_segments[i]);
+		}
+	}
+	return true;
+}
+
+bool DocumentList::RetrieveTextDocumentList (wxString path)
+{
 	wxFileInputStream file (path);
 	wxTextInputStream stored_data (file);
 
@@ -614,11 +2064,11 @@ bool DocumentList::ReadSingleDocumentDefinition (wxTextInputStream & stored_data
 		line = stored_data.ReadLine ();
 	}
 	// -- create the document and set all its parameters based on read data
-	Document * doc = new Document (pathname, id);
-	doc->SetName (name);
+	Document * doc = new Document (pathname);
 	doc->SetOriginalPathname (original_pathname);
-	doc->SetTrigramCount (num_trigrams);
-	_documents.push_back (doc);
+	AppendDocument (doc, id, name);
+	_table.SetTrigramCount (_table.Size () - 1, num_trigrams);
+	if (id == 0) _has_template_material = true;
 	// -- all ok, so return true
 	return true;
 }
@@ -645,6 +2095,7 @@ bool DocumentList::ReadTokenDefinitions (wxTextInputStream & stored_data)
 }
 
 // -- TODO: Some error checking on wxAtoi
+// -- the documents are read first, so template material is known from their group ids
 bool DocumentList::ReadTupleDefinitions (wxTextInputStream & stored_data)
 {
 	wxString line = stored_data.ReadLine ();
@@ -662,7 +2113,9 @@ bool DocumentList::ReadTupleDefinitions (wxTextInputStream & stored_data)
 		{
 			wxString next = items.GetNextToken ();
 			if (next.IsSameAs ("]")) break; // finish loop
-			_tuple_set.AddDocument (index0, index1, index2, wxAtoi (next), false); // TODO: true if template
+			int doc = wxAtoi (next);
+			if (doc < 0 || doc >= _table.Size ()) return false;
+			_tuple_set.AddDocument (index0, index1, index2, doc, _table.GetGroupId (doc) == 0);
 		}
 
 		line = stored_data.ReadLine ();
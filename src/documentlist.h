@@ -6,7 +6,12 @@
   */
 
 #include <assert.h>
+#include <algorithm>
+#include <istream>
 #include <map>
+#include <set>
+#include <string>
+#include <string.h>
 #include <vector>
 #include <wx/wx.h>
 #include <wx/dir.h>
@@ -14,9 +19,17 @@
 #include <wx/tokenzr.h>
 #include <wx/txtstrm.h>
 
+#include "archivereader.h"
+#include "corpusstatistics.h"
+#include "directorywalker.h"
+#include "signatureset.h"
+#include "winnower.h"
 #include "tokenset.h"
 #include "tupleset.h"
 #include "document.h"
+#include "documenttable.h"
+#include "mappedindex.h"
+#include "tokencache.h"
 
 /** Pair used in matches - 
  * keeps a count of number of matches where only A & B are present, 
@@ -25,6 +38,16 @@
 class MatchData
 {
   public:
+    MatchData () : common (0), unique (0), ignore (0), unique_ignore (0) {}
+    // add one shared trigram, given whether it is unique to the pair 
+    // and whether it is contained in template material
+    void AddMatch (bool is_unique, bool is_template);
+    // take away one shared trigram, counted as by AddMatch
+    void RemoveMatch (bool is_unique, bool is_template);
+    // add in all the counts from another MatchData
+    void Add (const MatchData & other);
+    // return the count for the given type of similarity measure
+    int GetCount (bool unique, bool ignore) const;
     int common;
     int unique;
     int ignore;
@@ -38,6 +61,28 @@ class MatchData
   *    such as Resemblance and Containment.
   * -- Note that the Documents are owned by this class although not created by it,
   *    and hence all Documents are destroyed with the DocumentList.
+  * -- group ids, names and trigram counts for each document are held in _table, 
+  *    which is kept in step with _documents.
+  * -- similarities are kept for the first _num_compared_documents documents,
+  *    and are stored with the list, so ComputeSimilarities only needs to 
+  *    include documents added or read since.
+  * -- a segmented store is a directory of files, each holding the documents, 
+  *    tokens and trigrams added since the previous segment, so saving only 
+  *    costs as much as the new documents (see AppendSegment).
+  * -- documents with the same contents as an earlier document are not read:
+  *    the earlier document stands for its copies in _tuple_set, and its 
+  *    matches are copied to theirs (see FindDuplicates)
+  * -- in approximate mode, no trigrams are indexed: each document read gets a 
+  *    MinHash signature in _signatures, and resemblance is estimated from the 
+  *    signatures (see SetMinHash)
+  * -- when using candidates, both the trigrams and the signatures are kept: 
+  *    pairs likely to be similar are found from the signatures, and only 
+  *    these are compared, exactly, with _matches holding just their matches
+  *    (see SetCandidateBands)
+  * -- when winnowing, only the fingerprints chosen by a Winnower from each 
+  *    document's trigrams are indexed and compared (see SetWinnowing)
+  * -- DocumentList cannot be copied, as it owns its Documents: pass a pointer
+  *    to hand over the list, e.g. from SelectFiles to ComparisonTableView.
   */
 class DocumentList
 {
@@ -77,11 +122,16 @@ class DocumentList
 		}
 	};
 	public:
-		DocumentList () : _last_group_id (0), _has_template_material (false) {}
+		DocumentList () : _num_bands (0), _winnow_window (0), _token_cache (NULL), _ingest_workers (0), _has_statistics (false), _last_group_id (0), _has_template_material (false), 
+			_num_pairs (-1), _num_compared_documents (0), _num_segment_documents (0), _num_segment_tokens (0) {}
 		~DocumentList ();
 		void AddDocument (wxString pathname, bool grouped=false, bool id0=false);
 		void AddDocument (wxString pathname, wxString name, int id);
 		bool AddDocumentsFromDefinitionFile (wxString pathname);
+		// add each path read from input, separated by NUL characters, as written by 'find -print0'
+		void AddDocumentsFromPathList (std::istream & input);
+		// skip files and folders whose names match the wildcard pattern, when adding a directory
+		void AddIgnorePattern (wxString pattern);
 		Document * operator [] (std::size_t i) const;
 		void RemoveDocument (Document * doc);
 		TokenSet & GetTokenSet ();
@@ -91,13 +141,60 @@ class DocumentList
     bool IsGrouped () const;
 		void ResetReading ();
 		int Size () const;
+    int GetGroupId (int i) const;
+    wxString GetName (int i) const;
+    wxString GetShortName (int i) const;
     int GroupSize () const;
     bool IsTemplateMaterial (int i) const;
     wxString GetGroupName (int index);
 		int NumberOfPairs () const;
 		bool MayNeedConversions () const;
 		void RunFerret (int first_document = 0);
+		// find documents, from first_document, with the same contents as an earlier 
+		// document, so they need not be read: called by RunFerret, before ReadDocument
+		void FindDuplicates (int first_document = 0);
+		bool IsDuplicate (int i) const;
+		int CountDuplicates () const;
 		void ReadDocument (int i);
+		// add the trigrams of document i as found by another reader, e.g. an IngestPipeline:
+		// tokens holds every token of the document in order first seen, and trigrams
+		// three indices into tokens for each distinct trigram
+		// -- cached is true if they were found with LookupCachedTrigrams; otherwise they
+		//    are stored in the token cache, if any, under the hash and length of the file
+		void AddReadTrigrams (int i, const std::vector<wxString> & tokens, const std::vector<wxUint32> & trigrams,
+				bool cached, wxUint64 hash, wxUint64 length);
+		// find the trigrams of document i in the token cache, given the hash and length 
+		// of its file's contents, returning false if there is no cache or no entry
+		// -- may be called from another thread while documents are read
+		bool LookupCachedTrigrams (int i, wxUint64 hash, wxUint64 length,
+				std::vector<wxString> & tokens, std::vector<wxUint32> & trigrams) const;
+		// read documents with an IngestPipeline of the given number of tokenising 
+		// workers, or one at a time if 0
+		void SetIngestWorkers (int workers);
+		wxString GetIngestReport () const; // -- empty unless the last run used a pipeline
+		// use a cache of the trigrams found in each file, or NULL for none
+		// -- the cache is not owned by the DocumentList
+		void SetTokenCache (TokenCache * cache);
+		bool UsesTokenCache () const;
+		// estimate similarities from MinHash signatures of the given number of hashes,
+		// without an index of the trigrams, or compute them exactly if 0
+		// -- set before reading documents
+		void SetMinHash (int num_hashes);
+		bool IsApproximate () const;
+		// compare only pairs of documents whose signatures agree on one of num_bands 
+		// bands of hashes, or all pairs if 0: the pairs are compared exactly, and 
+		// the rest taken to have no matches
+		// -- needs SetMinHash, whose hashes are split between the bands
+		void SetCandidateBands (int num_bands);
+		// index only the fingerprints picked by winnowing each document's trigrams, 
+		// in windows of the given number of trigrams, or every trigram if 0
+		// -- set before reading documents, and keep the same for a stored list
+		void SetWinnowing (int window);
+		int GetWinnowing () const;
+		bool UsesCandidates () const;
+		// the pairs of documents compared, when using candidates: pairs in different
+		// groups, ordered by first then second document, with document1 < document2
+		void GetCandidatePairs (std::vector<int> & document1, std::vector<int> & document2) const;
 		void ClearSimilarities ();
 		void ComputeSimilarities ();
 		int GetTotalTrigramCount ();
@@ -107,6 +204,11 @@ class DocumentList
 		float ComputeContainment (int doc_i, int doc_j, bool unique=false, bool ignore=false);
     int UniqueCount (int index) const;
     int EngagementCount (int index) const;
+    // count matches between all documents of two groups, indexed as for GetGroupName
+    int CountGroupMatches (int group_i, int group_j, bool unique=false, bool ignore=false) const;
+    // summary of similarities over all pairs of documents in different groups
+    // -- computed when first asked for after ComputeSimilarities
+    const CorpusStatistics & GetStatistics ();
 		// check if given trigram is in both the indexed documents
 		bool IsMatchingTrigram (std::size_t t0, std::size_t t1, std::size_t t2, int doc1, int doc2, bool unique=false, bool ignore=false);
 		bool IsTemplateTrigram (std::size_t t0, std::size_t t1, std::size_t t2);
@@ -121,20 +223,83 @@ class DocumentList
 		// for storing/retrieving list of documents and token/tuple definitions
 		void SaveDocumentList (wxString path);
 		bool RetrieveDocumentList (wxString path);
+		// for a store held as a directory of segments, with one added for each run
+		bool RetrieveSegments (wxString directory);
+		bool AppendSegment (wxString directory);
+		bool CompactSegments (wxString directory);
+		// for a read-only index, which is mapped into memory and used in place
+		bool SaveIndex (wxString path);
+		bool OpenIndex (wxString path);
     bool HasTemplateMaterial () const;
 	private:
+		DocumentList (const DocumentList &);             // -- not copyable, so
+		DocumentList & operator= (const DocumentList &); //    not implemented
+		void AppendDocument (Document * doc, int id, wxString name, wxString short_path = "");
+		void AddCachedTrigrams (int i, const std::vector<wxString> & tokens, const std::vector<wxUint32> & trigrams);
+		bool AddTrigram (int i, std::size_t t0, std::size_t t1, std::size_t t2, bool is_template, 
+				std::set<wxUint64> & signature_trigrams);
+		wxUint64 GetTokenHash (std::size_t token);
+		void ComputeAllSimilarities ();
+		void ComputeCandidateSimilarities ();
+		void FindCandidates ();
+		int FindCandidate (int doc1, int doc2) const;
+		bool CountTuple (const std::vector<int> & fvector, int num_holding);
+		void CopyDuplicateMatches (const std::vector<MatchData> & self_matches);
+		void ExpandDuplicates ();
+		void ExtendSimilarities (int first_new);
+		void ComputeGroupMatches ();
+		MatchData GetMatchData (int doc1, int doc2) const;
+		void ComputeGroupTotals ();
+		void ComputeStatistics ();
+		void AddPairStatistics (int doc1, int doc2);
+		int CountPairs () const;
+		void WriteDocumentDefinitions (BinaryWriter & output, int first_document = 0);
+		bool ReadDocumentDefinitions (BinaryReader & input);
+		void WriteSimilarities (BinaryWriter & output);
+		bool ReadSimilarities (BinaryReader & input);
+		bool RetrieveBinaryDocumentList (wxString path);
+		bool ReadSections (BinaryReader & input, wxUint32 num_sections);
+		bool ReadSegments (wxString directory, wxArrayString & segments);
+		bool ReadSegment (wxString path);
+		bool WriteSegment (wxString path, int first_document, std::size_t first_token);
+		bool RetrieveTextDocumentList (wxString path);
 		bool ReadDocumentDefinitions (wxTextInputStream & stored_data);
 		bool ReadSingleDocumentDefinition (wxTextInputStream & stored_data);
 		bool ReadTokenDefinitions (wxTextInputStream & stored_data);
 		bool ReadTupleDefinitions (wxTextInputStream & stored_data);
 	private:
 		std::vector<Document *>	_documents;
+		DocumentTable		_table;
     std::map<int, wxString> _group_names;
 		TokenSet		_token_set;
 		TupleSet		_tuple_set;
-		std::vector<MatchData *>	_matches;
+		SignatureSet	_signatures; // -- only used in approximate mode, or with candidates
+		int		_num_bands;  // -- 0 unless using candidates
+		int		_winnow_window; // -- 0 unless winnowing
+		std::vector<wxUint64>	_token_hashes; // -- hash of each token's text, as needed for winnowing
+		std::vector<int>	_candidate_starts;   // -- for each document, the start of its 
+		std::vector<int>	_candidate_partners; //    later partners, whose matches are at 
+		                                     //    the same index in _matches
+		MappedIndex		_index; // -- base for _token_set and _tuple_set, if open
+		ArchiveReader	_archive; // -- archive of last document read, if any
+		TokenCache *	_token_cache;
+		int		_ingest_workers;
+		wxString	_ingest_report;
+		wxArrayString	_ignore_patterns; // -- added to those of the DirectoryWalker
+		std::map<int, int>	_duplicate_of; // -- copy -> earlier document with the same contents, 
+		                                   //    until the copies are added to _tuple_set
+		std::vector<MatchData>	_matches;
+		std::vector<MatchData>	_group_matches; // group x group totals, only kept when grouped
+		std::vector<int>	_group_unique_counts;     // indexed as for GetGroupName, 
+		std::vector<int>	_group_engagement_counts; // found after ComputeSimilarities
+		CorpusStatistics	_statistics;
+		bool		_has_statistics; // -- false until GetStatistics fills in _statistics
 		int			    _last_group_id;
     int         _has_template_material;
+    int         _num_pairs; // -- -1 if not yet computed
+		int			_num_compared_documents; // -- first documents with similarities in _matches
+		int			_num_segment_documents; // -- documents and tokens already held
+		std::size_t	_num_segment_tokens;    //    in the segmented store
 };
 
 #endif
@@ -0,0 +1,99 @@
+#include "documenttable.h"
+
+// *** StringPool
+
+int StringPool::GetIndexFor (wxString str)
+{
+	std::map<wxString, int>::const_iterator it = _indices.find (str);
+	if (it != _indices.end ()) // found it
+	{
+		return it->second;
+	}
+	else // otherwise, make a new index
+	{
+		int index = _strings.size ();
+		_strings.push_back (str);
+		_indices[str] = index;
+		return index;
+	}
+}
+
+const wxString & StringPool::GetString (int index) const
+{
+	assert (index >= 0 && index < _strings.size ());
+	return _strings[index];
+}
+
+void StringPool::Clear ()
+{
+	_strings.clear ();
+	_indices.clear ();
+}
+
+// *** DocumentTable
+
+void DocumentTable::Clear ()
+{
+	_group_ids.clear ();
+	_trigram_counts.clear ();
+	_unique_counts.clear ();
+	_engagement_counts.clear ();
+	_name_ids.clear ();
+	_short_path_ids.clear ();
+	_strings.Clear ();
+}
+
+void DocumentTable::Append (int group_id, wxString name, wxString short_path)
+{
+	_group_ids.push_back (group_id);
+	_trigram_counts.push_back (0);
+	_unique_counts.push_back (0);
+	_engagement_counts.push_back (0);
+	_name_ids.push_back (_strings.GetIndexFor (name));
+	_short_path_ids.push_back (_strings.GetIndexFor (short_path));
+}
+
+// remove document i, moving all later documents down one place
+// -- strings are left in the pool, as other documents may share them
+void DocumentTable::Erase (int i)
+{
+	assert (i >= 0 && i < Size ());
+	_group_ids.erase (_group_ids.begin () + i);
+	_trigram_counts.erase (_trigram_counts.begin () + i);
+	_unique_counts.erase (_unique_counts.begin () + i);
+	_engagement_counts.erase (_engagement_counts.begin () + i);
+	_name_ids.erase (_name_ids.begin () + i);
+	_short_path_ids.erase (_short_path_ids.begin () + i);
+}
+
+// unique and engagement counts are found when computing similarities,
+// so are cleared before each computation
+void DocumentTable::ResetComparisonCounts ()
+{
+	_unique_counts.assign (_unique_counts.size (), 0);
+	_engagement_counts.assign (_engagement_counts.size (), 0);
+}
+
+const wxString & DocumentTable::GetName (int i) const
+{
+	return _strings.GetString (_name_ids[i]);
+}
+
+void DocumentTable::SetName (int i, wxString name)
+{
+	_name_ids[i] = _strings.GetIndexFor (name);
+}
+
+// short name is the base directory from select files (if present) and the name
+wxString DocumentTable::GetShortName (int i) const
+{
+	const wxString & short_path = _strings.GetString (_short_path_ids[i]);
+	if (short_path != "")
+	{
+		return short_path + "/.../" + GetName (i);
+	}
+	else
+	{
+		return GetName (i);
+	}
+}
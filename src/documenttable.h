@@ -0,0 +1,71 @@
+#if !defined documenttable_h
+#define documenttable_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <assert.h>
+#include <map>
+#include <vector>
+#include <wx/wx.h>
+
+/** A StringPool stores each distinct string once, and refers to it by index.
+  * -- used for names and short paths, which repeat across many documents
+  *    (e.g. every student submitting a file called 'main.java')
+  */
+class StringPool
+{
+	public:
+		int GetIndexFor (wxString str);
+		const wxString & GetString (int index) const;
+		void Clear ();
+	private:
+		std::vector<wxString> _strings;
+		std::map<wxString, int> _indices;
+};
+
+/** DocumentTable holds the per-document information needed when comparing
+  * documents, as a set of parallel arrays indexed by document number.
+  * -- the loops over trigrams and pairs of documents in DocumentList
+  *    only touch these compact arrays, and never a Document
+  * -- group_id places documents into groups: documents with the same id
+  *    are not compared against each other, and id 0 marks template material
+  * -- names and short paths are held in a shared StringPool
+  */
+class DocumentTable
+{
+	public:
+		void Clear ();
+		int Size () const { return _group_ids.size (); }
+		void Append (int group_id, wxString name, wxString short_path);
+		void Erase (int i);
+		// group ids, also as a contiguous array for the comparison loops
+		int GetGroupId (int i) const { return _group_ids[i]; }
+		const std::vector<int> & GetGroupIds () const { return _group_ids; }
+		// information about trigrams in document
+		int GetTrigramCount (int i) const { return _trigram_counts[i]; }
+		void SetTrigramCount (int i, int count) { _trigram_counts[i] = count; }
+		void IncrementTrigramCount (int i) { _trigram_counts[i] += 1; }
+		int GetUniqueCount (int i) const { return _unique_counts[i]; }
+		void SetUniqueCount (int i, int count) { _unique_counts[i] = count; }
+		void IncrementUniqueCount (int i) { _unique_counts[i] += 1; }
+		void DecrementUniqueCount (int i) { _unique_counts[i] -= 1; }
+		int GetEngagementCount (int i) const { return _engagement_counts[i]; }
+		void SetEngagementCount (int i, int count) { _engagement_counts[i] = count; }
+		void IncrementEngagementCount (int i) { _engagement_counts[i] += 1; }
+		void ResetComparisonCounts ();
+		// names for display
+		const wxString & GetName (int i) const;
+		void SetName (int i, wxString name);
+		wxString GetShortName (int i) const;
+	private:
+		std::vector<int> _group_ids;
+		std::vector<int> _trigram_counts;
+		std::vector<int> _unique_counts;
+		std::vector<int> _engagement_counts;
+		std::vector<int> _name_ids;       // -- index into _strings
+		std::vector<int> _short_path_ids; // -- index into _strings
+		StringPool       _strings;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "extractioncache.h"
+
+ExtractionCache::ExtractionCache (wxString folder, wxULongLong max_size)
+	: _folder (folder),
+	  _max_size (max_size),
+	  _size (0),
+	  _hits (0),
+	  _misses (0)
+{
+	if (!wxFileName::DirExists (_folder))
+	{
+		wxFileName::Mkdir (_folder, 0777, wxPATH_MKDIR_FULL);
+	}
+	wxArrayString entries;
+	wxDir::GetAllFiles (_folder, &entries, "*.txt", wxDIR_FILES);
+	for (int i = 0, n = entries.GetCount (); i < n; ++i)
+	{
+		_size += wxFileName::GetSize (entries[i]);
+	}
+}
+
+// -- the converter's command line is hashed after the document's contents
+wxString ExtractionCache::GetKey (wxString source, wxString converter) const
+{
+	wxUint64 hash;
+	wxUint64 length;
+	if (!ContentHash::HashFile (source, hash, length)) return "";
+	ContentHash key (hash);
+	const wxCharBuffer command = converter.utf8_str ();
+	key.Update (command.data (), strlen (command.data ()));
+	wxUint64 value = key.GetHash ();
+	return wxString::Format ("%08x%08x", 
+			(unsigned int)(value >> 32), (unsigned int)(value & 0xFFFFFFFF));
+}
+
+wxString ExtractionCache::GetEntryPath (wxString key) const
+{
+	return wxFileName (_folder, key + ".txt").GetFullPath ();
+}
+
+// -- the entry's modification time is updated, marking it as recently used
+bool ExtractionCache::Fetch (wxString key, wxString target)
+{
+	wxFileName entry (GetEntryPath (key));
+	if (entry.FileExists () && wxCopyFile (entry.GetFullPath (), target, true))
+	{
+		entry.Touch ();
+		_hits += 1;
+		return true;
+	}
+	_misses += 1;
+	return false;
+}
+
+// -- copied to a temporary file and renamed, so other runs never see part of an entry
+void ExtractionCache::Store (wxString key, wxString extracted)
+{
+	wxString path = GetEntryPath (key);
+	wxString temporary_path = path + wxString::Format (".%lu.tmp", wxGetProcessId ());
+	if (!wxCopyFile (extracted, temporary_path, true) ||
+			!wxRenameFile (temporary_path, path, true))
+	{
+		wxRemoveFile (temporary_path);
+		return;
+	}
+	_size += wxFileName::GetSize (path);
+	if (_size > _max_size)
+	{
+		Evict ();
+	}
+}
+
+// remove entries, least recently used first, until within three quarters of 
+// the maximum size, so eviction is not needed on every store
+void ExtractionCache::Evict ()
+{
+	wxArrayString entries;
+	wxDir::GetAllFiles (_folder, &entries, "*.txt", wxDIR_FILES);
+	std::vector<std::pair<time_t, int> > by_age;
+	_size = 0;
+	for (int i = 0, n = entries.GetCount (); i < n; ++i)
+	{
+		by_age.push_back (std::make_pair (wxFileName (entries[i]).GetModificationTime ().GetTicks (), i));
+		_size += wxFileName::GetSize (entries[i]);
+	}
+	std::sort (by_age.begin (), by_age.end ());
+
+	wxULongLong target_size = _max_size / 4 * 3;
+	for (int i = 0, n = by_age.size (); i < n && _size > target_size; ++i)
+	{
+		wxString entry = entries[by_age[i].second];
+		wxULongLong entry_size = wxFileName::GetSize (entry);
+		if (wxRemoveFile (entry))
+		{
+			_size -= entry_size;
+		}
+	}
+}
+
+int ExtractionCache::GetHits () const
+{
+	return _hits;
+}
+
+int ExtractionCache::GetMisses () const
+{
+	return _misses;
+}
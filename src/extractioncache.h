@@ -0,0 +1,49 @@
+#if !defined extractioncache_h
+#define extractioncache_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <algorithm>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+
+#include "contenthash.h"
+
+/** ExtractionCache keeps the text extracted from pdf and word-processor 
+  * documents, so unchanged documents need not be converted on every run.
+  * -- entries are keyed by the hash of the source document's contents and the 
+  *    converter's command line (without file names), so changing the 
+  *    converter's options gives new entries
+  * -- each entry is a text file in the cache folder, copied to the extract 
+  *    folder when found
+  * -- the folder is kept within a maximum size, by removing the entries 
+  *    least recently used when an entry is added
+  */
+class ExtractionCache
+{
+	public:
+		ExtractionCache (wxString folder, wxULongLong max_size);
+		// key for the source document and converter, or empty if the document cannot be read
+		wxString GetKey (wxString source, wxString converter) const;
+		// copy the cached text for key to target, returning false if there is none
+		bool Fetch (wxString key, wxString target);
+		// add the extracted text in the given file to the cache
+		void Store (wxString key, wxString extracted);
+		int GetHits () const;
+		int GetMisses () const;
+	private:
+		wxString GetEntryPath (wxString key) const;
+		void Evict ();
+		wxString _folder;
+		wxULongLong _max_size;
+		wxULongLong _size; // -- approximate size of the entries in the folder
+		int _hits;
+		int _misses;
+};
+
+#endif
+
@@ -13,6 +13,11 @@ FerretApp::FerretApp ()
 	_copy_all = false;
 	_convert_all = false;
 	_ignore_unknown = true;
+	_extraction_cache = NULL;
+	_bypass_extraction_cache = false;
+	_conversion_processes = ConversionPool::GetDefaultSize ();
+	_conversion_timeout = 300;
+	_stream_pdf = false;
 	_last_x = 0;
 	_last_y = (
 	#if __WXMAC__ 
@@ -23,6 +28,11 @@ FerretApp::FerretApp ()
 	);
 }
 
+FerretApp::~FerretApp ()
+{
+	delete _extraction_cache;
+}
+
 void FerretApp::CloseHelp ()
 {
 	_ferret_help->Destroy ();
@@ -136,6 +146,48 @@ const wxSortedArrayString & FerretApp::GetIgnoredFiles () const
 	return _ignored_files;
 }
 
+// The cache is kept in the user's data folder, and limited to 256MB
+ExtractionCache * FerretApp::GetExtractionCache ()
+{
+	if (_bypass_extraction_cache) return NULL;
+	if (_extraction_cache == NULL)
+	{
+		wxString folder = wxStandardPaths::Get().GetUserDataDir () + wxFILE_SEP_PATH + "ExtractionCache";
+		_extraction_cache = new ExtractionCache (folder, wxULongLong (256 * 1024 * 1024));
+	}
+	return _extraction_cache;
+}
+
+void FerretApp::SetBypassExtractionCache (bool bypass)
+{
+	_bypass_extraction_cache = bypass;
+}
+
+int FerretApp::GetConversionProcesses () const
+{
+	return _conversion_processes;
+}
+
+void FerretApp::SetConversionProcesses (int processes)
+{
+	_conversion_processes = processes;
+}
+
+int FerretApp::GetConversionTimeout () const
+{
+	return _conversion_timeout;
+}
+
+bool FerretApp::GetStreamPdf () const
+{
+	return _stream_pdf;
+}
+
+void FerretApp::SetStreamPdf (bool stream_pdf)
+{
+	_stream_pdf = stream_pdf;
+}
+
 // helps stagger created windows on screen -- goes down screen then across
 wxPoint FerretApp::GetNextFramePosition (int window_width, int window_height)
 {
@@ -11,6 +11,9 @@
 #include <wx/filename.h>
 #include <wx/stdpaths.h>
 
+#include "conversionpool.h"
+#include "extractioncache.h"
+
 /** FerretApp is the main class of the application.
   * Program starts in OnInit method, which opens an instance of the document selector frame.
   * FerretApp is responsible for maintaining the help frame
@@ -21,6 +24,7 @@ class FerretApp: public wxApp
 {
 	public:
 		FerretApp ();
+		~FerretApp ();
 		virtual bool OnInit ();
 		void CloseHelp ();
     void RemoveFolders ();
@@ -44,6 +48,16 @@ class FerretApp: public wxApp
 		const wxSortedArrayString & GetProblemFiles () const;
 		void AddIgnoredFile (wxString file);
 		const wxSortedArrayString & GetIgnoredFiles () const;
+		// cache of extracted text, NULL if bypassed
+		ExtractionCache * GetExtractionCache ();
+		void SetBypassExtractionCache (bool bypass);
+		// number of converters to run at once, and seconds before stopping one
+		int GetConversionProcesses () const;
+		void SetConversionProcesses (int processes);
+		int GetConversionTimeout () const;
+		// read pdf text straight from pdftotext when documents are read
+		bool GetStreamPdf () const;
+		void SetStreamPdf (bool stream_pdf);
 		// END
 		wxPoint GetNextFramePosition (int window_width, int window_height);
 	private:
@@ -56,6 +70,11 @@ class FerretApp: public wxApp
 		bool _copy_all;
 		bool _convert_all;
 		bool _ignore_unknown;
+		ExtractionCache * _extraction_cache; // -- created on first use
+		bool _bypass_extraction_cache;
+		int _conversion_processes;
+		int _conversion_timeout;
+		bool _stream_pdf;
 		// parameters for placing widgets
 		int _last_x;
 		int _last_y;
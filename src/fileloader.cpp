@@ -0,0 +1,325 @@
+#include "fileloader.h"
+
+// -- each thread of the fallback pool reads files until the loader closes
+class FileLoader::ReadThread : public wxThread
+{
+	public:
+		ReadThread (FileLoader & loader)
+			: wxThread (wxTHREAD_JOINABLE), _loader (loader)
+		{}
+		virtual void * Entry ()
+		{
+			_loader.ReadFiles ();
+			return NULL;
+		}
+	private:
+		FileLoader & _loader;
+};
+
+FileLoader::FileLoader (int max_reads, bool allow_io_uring)
+	: _max_reads (max_reads < 1 ? 1 : max_reads),
+	  _size (0),
+	  _requests (_max_reads),
+	  _finished_ready (_mutex)
+{
+#if FILELOADER_IO_URING
+	_ring_fd = -1;
+	_to_submit = 0;
+	_in_flight = 0;
+	if (allow_io_uring && OpenRing (_max_reads)) return;
+#endif
+	// -- reading is mostly waiting on the disk, so use more threads than processors
+	int num_threads = (_max_reads < 16 ? _max_reads : 16);
+	for (int i = 0; i < num_threads; ++i)
+	{
+		ReadThread * thread = new ReadThread (* this);
+		thread->Create ();
+		thread->Run ();
+		_threads.push_back (thread);
+	}
+}
+
+FileLoader::~FileLoader ()
+{
+#if FILELOADER_IO_URING
+	if (_ring_fd != -1)
+	{
+		// -- the kernel writes into requests until their operations complete
+		for (int i = 0, n = _waiting.size (); i < n; ++i) delete _waiting[i];
+		_waiting.clear ();
+		while (_in_flight > 0) RunRing ();
+		CloseRing ();
+	}
+#endif
+	_requests.Close ();
+	for (int i = 0, n = _threads.size (); i < n; ++i)
+	{
+		_threads[i]->Wait ();
+		delete _threads[i];
+	}
+	for (int i = 0, n = _finished.size (); i < n; ++i) delete _finished[i];
+}
+
+void FileLoader::Add (int id, wxString path)
+{
+	Request * request = new Request;
+	request->id = id;
+	request->path = wxString (path.wc_str ());
+	request->native_path = std::string (path.fn_str ());
+	request->fd = -1;
+	request->length = 0;
+	request->operation = 0;
+	request->ok = false;
+	_size += 1;
+#if FILELOADER_IO_URING
+	if (_ring_fd != -1)
+	{
+		_waiting.push_back (request); // -- submitted together by WaitForNext
+		return;
+	}
+#endif
+	_requests.Push (request);
+}
+
+bool FileLoader::WaitForNext (int & id, std::vector<char> & contents, bool & ok)
+{
+	if (_size == 0) return false;
+
+	Request * request;
+	{
+		wxMutexLocker lock (_mutex);
+		while (_finished.empty ())
+		{
+#if FILELOADER_IO_URING
+			if (_ring_fd != -1)
+			{
+				RunRing (); // -- only this thread uses the ring, so no other will signal
+				continue;
+			}
+#endif
+			_finished_ready.Wait ();
+		}
+		request = _finished.front ();
+		_finished.pop_front ();
+	}
+	id = request->id;
+	contents.swap (request->contents);
+	ok = request->ok;
+	delete request;
+	_size -= 1;
+	return true;
+}
+
+int FileLoader::Size () const
+{
+	return _size;
+}
+
+wxString FileLoader::GetMethod () const
+{
+#if FILELOADER_IO_URING
+	if (_ring_fd != -1) return "io_uring";
+#endif
+	return "threads";
+}
+
+// -- run by each ReadThread
+void FileLoader::ReadFiles ()
+{
+	Request * request;
+	while (_requests.Pop (request))
+	{
+		ReadFile (request);
+		wxMutexLocker lock (_mutex);
+		_finished.push_back (request);
+		_finished_ready.Signal ();
+	}
+}
+
+// -- the request's path is not shared with other threads, see Add
+void FileLoader::ReadFile (Request * request)
+{
+	wxFile file (request->path);
+	if (!file.IsOpened ()) return;
+	wxFileOffset length = file.Length ();
+	if (length < 0) return;
+	request->contents.resize (length);
+	request->ok = (length == 0 || file.Read (&request->contents[0], length) == length);
+}
+
+#if FILELOADER_IO_URING
+
+// Set up an io_uring, following io_uring_setup(2), returning false if it is
+// unavailable or lacks the operations used (openat, read and close need Linux 5.6)
+bool FileLoader::OpenRing (unsigned entries)
+{
+	struct io_uring_params params;
+	memset (&params, 0, sizeof (params));
+	int fd = syscall (__NR_io_uring_setup, entries, &params);
+	if (fd < 0) return false;
+
+	std::vector<char> probe_buffer (sizeof (struct io_uring_probe) + 256 * sizeof (struct io_uring_probe_op), 0);
+	struct io_uring_probe * probe = (struct io_uring_probe *) &probe_buffer[0];
+	bool supported = (syscall (__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0);
+	int operations[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE };
+	for (int i = 0; supported && i < 3; ++i)
+	{
+		supported = (operations[i] <= probe->last_op &&
+				(probe->ops[operations[i]].flags & IO_URING_OP_SUPPORTED));
+	}
+	if (!supported || params.sq_entries < entries)
+	{
+		close (fd);
+		return false;
+	}
+
+	_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+	_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+	bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+	if (single_mmap)
+	{
+		if (_cq_ring_size > _sq_ring_size) _sq_ring_size = _cq_ring_size;
+		_cq_ring_size = _sq_ring_size;
+	}
+	_sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+	_sq_ring = mmap (NULL, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	_cq_ring = (single_mmap ? _sq_ring :
+			mmap (NULL, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING));
+	void * sqes = mmap (NULL, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (_sq_ring == MAP_FAILED || _cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+	{
+		if (sqes != MAP_FAILED) munmap (sqes, _sqes_size);
+		if (_cq_ring != MAP_FAILED && !single_mmap) munmap (_cq_ring, _cq_ring_size);
+		if (_sq_ring != MAP_FAILED) munmap (_sq_ring, _sq_ring_size);
+		close (fd);
+		return false;
+	}
+
+	char * sq = (char *) _sq_ring;
+	_sq_head = (unsigned *)(sq + params.sq_off.head);
+	_sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	_sq_mask = * (unsigned *)(sq + params.sq_off.ring_mask);
+	_sq_array = (unsigned *)(sq + params.sq_off.array);
+	_sq_entries = params.sq_entries;
+	char * cq = (char *) _cq_ring;
+	_cq_head = (unsigned *)(cq + params.cq_off.head);
+	_cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	_cq_mask = * (unsigned *)(cq + params.cq_off.ring_mask);
+	_cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+	_sqes = (struct io_uring_sqe *) sqes;
+	_ring_fd = fd;
+	return true;
+}
+
+void FileLoader::CloseRing ()
+{
+	munmap (_sqes, _sqes_size);
+	if (_cq_ring != _sq_ring) munmap (_cq_ring, _cq_ring_size);
+	munmap (_sq_ring, _sq_ring_size);
+	close (_ring_fd);
+	_ring_fd = -1;
+}
+
+// Open waiting files, keeping no more than _max_reads in flight
+// -- each open request has one operation in flight, so the queues cannot overflow
+void FileLoader::SubmitWaiting ()
+{
+	while (!_waiting.empty () && _in_flight < _max_reads)
+	{
+		Submit (IORING_OP_OPENAT, _waiting.front ());
+		_waiting.pop_front ();
+	}
+}
+
+// Submit all queued operations, wait for at least one to complete,
+// and handle every completed operation
+void FileLoader::RunRing ()
+{
+	SubmitWaiting ();
+	int submitted = syscall (__NR_io_uring_enter, _ring_fd, _to_submit,
+			(_in_flight > 0 ? 1 : 0), IORING_ENTER_GETEVENTS, NULL, 0);
+	if (submitted > 0) _to_submit -= submitted;
+	// -- on error (e.g. interrupted), nothing is submitted: completions are
+	//    handled, making room, and the submission tried again on the next call
+
+	unsigned head = * _cq_head;
+	unsigned tail = __atomic_load_n (_cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; ++head)
+	{
+		struct io_uring_cqe * cqe = &_cqes[head & _cq_mask];
+		HandleCompletion ((Request *)(uintptr_t) cqe->user_data, cqe->res);
+	}
+	__atomic_store_n (_cq_head, head, __ATOMIC_RELEASE);
+}
+
+// -- reads go into the request's contents, which are grown while reads fill them
+void FileLoader::Submit (int operation, Request * request)
+{
+	unsigned tail = * _sq_tail;
+	unsigned index = tail & _sq_mask;
+	struct io_uring_sqe * sqe = &_sqes[index];
+	memset (sqe, 0, sizeof (* sqe));
+	sqe->opcode = operation;
+	sqe->user_data = (wxUint64)(uintptr_t) request;
+	if (operation == IORING_OP_OPENAT)
+	{
+		sqe->fd = AT_FDCWD;
+		sqe->addr = (wxUint64)(uintptr_t) request->native_path.c_str ();
+		sqe->open_flags = O_RDONLY | O_CLOEXEC;
+	}
+	else if (operation == IORING_OP_READ)
+	{
+		std::size_t size = request->contents.size ();
+		request->contents.resize (size < 16384 ? 16384 : 2 * size);
+		sqe->fd = request->fd;
+		sqe->addr = (wxUint64)(uintptr_t) &request->contents[request->length];
+		sqe->len = request->contents.size () - request->length;
+		sqe->off = request->length;
+	}
+	else // IORING_OP_CLOSE
+	{
+		sqe->fd = request->fd;
+	}
+	request->operation = operation;
+	_sq_array[index] = index;
+	__atomic_store_n (_sq_tail, tail + 1, __ATOMIC_RELEASE);
+	_to_submit += 1;
+	_in_flight += 1;
+}
+
+// Move a request on to its next operation, finishing it once its file is closed
+// -- files are regular files, so a read which does not fill the buffer
+//    has reached the end of the file
+void FileLoader::HandleCompletion (Request * request, int result)
+{
+	_in_flight -= 1;
+	if (request->operation == IORING_OP_OPENAT)
+	{
+		if (result < 0)
+		{
+			_finished.push_back (request); // -- not ok: file could not be opened
+			return;
+		}
+		request->fd = result;
+		Submit (IORING_OP_READ, request);
+	}
+	else if (request->operation == IORING_OP_READ)
+	{
+		if (result > 0) request->length += result;
+		if (result > 0 && request->length == request->contents.size ())
+		{
+			Submit (IORING_OP_READ, request);
+			return;
+		}
+		request->ok = (result >= 0);
+		request->contents.resize (request->length);
+		Submit (IORING_OP_CLOSE, request);
+	}
+	else // IORING_OP_CLOSE
+	{
+		_finished.push_back (request);
+	}
+}
+
+#endif
+
@@ -0,0 +1,109 @@
+#if !defined fileloader_h
+#define fileloader_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/file.h>
+#include <wx/thread.h>
+
+#include "boundedqueue.h"
+
+#if __WXGTK__ && defined __linux__
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined __NR_io_uring_setup
+#include <linux/io_uring.h>
+#if defined IORING_FEAT_RW_CUR_POS // -- headers include openat/read/close operations
+#define FILELOADER_IO_URING 1
+#endif
+#endif
+#endif
+
+/** FileLoader reads whole files into memory, keeping many reads in flight,
+  * so corpora of many small files are not held up waiting for each file
+  * to be opened, read and closed in turn.
+  * -- each file is added with an id, and WaitForNext returns the id and
+  *    contents of each file as its read completes, in any order
+  * -- on Linux, files are opened, read and closed through an io_uring, so
+  *    a batch of requests costs one system call; where io_uring is not
+  *    available (older kernels, or where it is disabled), or on other
+  *    platforms, a pool of threads reads the files with wxFile
+  */
+class FileLoader
+{
+	public:
+		// -- allow_io_uring may be false to use the pool of threads, e.g. for comparison
+		FileLoader (int max_reads = 64, bool allow_io_uring = true);
+		~FileLoader ();
+		void Add (int id, wxString path);
+		// wait for a file to be read, giving its id and contents, and whether it could be read
+		// -- returns false when there are no more files
+		bool WaitForNext (int & id, std::vector<char> & contents, bool & ok);
+		int Size () const; // -- files added, but not yet returned by WaitForNext
+		wxString GetMethod () const; // -- "io_uring" or "threads", for reports
+	private:
+		FileLoader (const FileLoader &);             // -- not copyable
+		FileLoader & operator= (const FileLoader &);
+		struct Request
+		{
+			int id;
+			wxString path;           // -- a private copy, made with wc_str, for this request alone
+			std::string native_path; // -- path for the system, converted as by wxFile, for io_uring
+			int fd;
+			std::vector<char> contents;
+			std::size_t length;   // -- bytes read so far
+			int operation;        // -- io_uring operation in flight
+			bool ok;
+		};
+		class ReadThread;
+		friend class ReadThread;
+		void ReadFiles ();
+		static void ReadFile (Request * request);
+#if FILELOADER_IO_URING
+		bool OpenRing (unsigned entries);
+		void CloseRing ();
+		void SubmitWaiting ();
+		void RunRing ();
+		void Submit (int operation, Request * request);
+		void HandleCompletion (Request * request, int result);
+		int		_ring_fd;     // -- -1 if io_uring is not used
+		void *		_sq_ring;
+		std::size_t	_sq_ring_size;
+		void *		_cq_ring;
+		std::size_t	_cq_ring_size;
+		struct io_uring_sqe *	_sqes;
+		std::size_t	_sqes_size;
+		unsigned *	_sq_head;
+		unsigned *	_sq_tail;
+		unsigned	_sq_mask;
+		unsigned *	_sq_array;
+		unsigned	_sq_entries;
+		unsigned *	_cq_head;
+		unsigned *	_cq_tail;
+		unsigned	_cq_mask;
+		struct io_uring_cqe *	_cqes;
+		unsigned	_to_submit;   // -- entries queued since the last io_uring_enter
+		int		_in_flight;   // -- operations submitted and not yet completed
+		std::deque<Request *>	_waiting; // -- added, but not yet opened
+#endif
+		int		_max_reads;
+		int		_size;
+		std::vector<ReadThread *>	_threads; // -- empty if io_uring is used
+		BoundedQueue<Request *>	_requests;
+		wxMutex		_mutex;      // -- guards _finished
+		wxCondition	_finished_ready;
+		std::deque<Request *>	_finished;
+};
+
+#endif
+
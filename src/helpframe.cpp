@@ -32,7 +32,7 @@ HelpFrame::HelpFrame ()
 
 			"Further settings:\n\nAdvanced users may use the 'Settings ...' button to reveal some further settings.  The settings affect how Ferret handles documents which do not appear to be plain text.\n\n" 
 "When converting files, Ferret will save the files into the named folder.  The user can direct Ferret to use a different folder using the 'Browse ...' button.  This option is particularly useful for collecting together files from multiple folders into one place.\nFerret will only copy the converted files to the destination folder; check the first box if you want every file to be copied.\n\nIf you want every file to be treated as a word/rtf file (for example, with mislabelled student or pupil work), check the second box.\n\nIf you want to ignore any unknown files (for example, output from compilers or image files), check the third box.  (Ferret's initial settings mean it will ignore unknown filetypes, so uncheck if you want Ferret to process all files.)\n\n" 
-"Ferret will treat files ending in .doc, .docx or .rtf as word/rtf files, and use 'abiword' to convert them to text.  Files ending in .pdf will be converted using 'pdftotext'.  Files ending in .txt will be treated as plain text files, and not converted.  Files for major programming languages are parsed specially.\n\n";
+"Ferret will treat files ending in .doc, .docx, .odt or .rtf as word/rtf files, and use 'abiword' to convert them to text; the text of .docx and .odt files is read directly.  Files ending in .pdf will be converted using 'pdftotext'.  Files ending in .txt will be treated as plain text files, and not converted.  Files for major programming languages are parsed specially.\n\n";
 	
 	wxString table_text = "Ferret produces a similarity score for every pair of documents in the selected list.  The similarity score runs from 0 (no copied sequences) to 1 (every sequence is copied).  Initially, the table is arranged with the most similar pairs of documents at the top.\n\nThe table may be rearranged into alphabetical order of name or numerical order of similarity by clicking on the respective button to the right (clicking on the column heading also rearranges the table).  The table, along with other relevant information, may be saved as a pdf or xml file, using the 'Save Report ...' button; the user will be prompted for a folder and filename to save the report in.\n\n" "You can see details of how the two documents are analysed, and the copied sequences, by clicking on a line in the table.  The 'Show Analysis' button will open a new window, showing the two documents; you can also show the analysis by double-clicking on the line.  The 'Save Analysis ...' button creates a pdf report highlighting the common trigrams in the two documents; the user will be prompted for a folder and filename to save the analysis in.\n\nYou may open as many of the analysis windows as you wish.\n";
 
@@ -0,0 +1,122 @@
+/** ingestbench -- times reading every file in a directory into memory:
+  *   one file at a time, as Document::StartInput reads them,
+  *   and with a FileLoader, through io_uring (where available) and a pool of threads
+  * Usage: ingestbench directory [reads-in-flight] [rounds]
+  * -- each way is run for the given number of rounds, and the fastest
+  *    round reported; the first round also brings the files into the
+  *    page cache, so later rounds mostly time the system calls
+  * -- see 'rake benchmark', which builds a tree of many small files
+  *
+  * (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <iostream>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/init.h>
+#include <wx/wfstream.h>
+
+#include "fileloader.h"
+
+// read each file through a wxFileInputStream, returning total bytes read
+wxUint64 readOneAtATime (const wxArrayString & files)
+{
+	wxUint64 total = 0;
+	std::vector<char> buffer (65536);
+	for (int i = 0, n = files.GetCount (); i < n; ++i)
+	{
+		wxFile * file = new wxFile (files[i]);
+		if (file->IsOpened ())
+		{
+			wxFileInputStream * input = new wxFileInputStream (* file);
+			while (!input->Eof ())
+			{
+				input->Read (&buffer[0], buffer.size ());
+				total += input->LastRead ();
+				if (input->LastRead () == 0) break;
+			}
+			delete input;
+		}
+		delete file;
+	}
+	return total;
+}
+
+// read the files with a FileLoader, giving the method it used
+wxUint64 readWithLoader (const wxArrayString & files, int max_reads, bool allow_io_uring, wxString & method)
+{
+	wxUint64 total = 0;
+	FileLoader loader (max_reads, allow_io_uring);
+	method = loader.GetMethod ();
+	int next = 0;
+	int num_files = files.GetCount ();
+	while (next < num_files || loader.Size () > 0)
+	{
+		// -- keep the loader supplied, as the ingest pipeline does
+		while (next < num_files && loader.Size () < 2 * max_reads)
+		{
+			loader.Add (next, files[next]);
+			next += 1;
+		}
+		int id;
+		bool ok;
+		std::vector<char> contents;
+		if (loader.WaitForNext (id, contents, ok)) total += contents.size ();
+	}
+	return total;
+}
+
+void report (wxString method, long best_time, int num_files, wxUint64 bytes)
+{
+	std::cout << method << ": " << best_time << " ms, "
+		<< (best_time > 0 ? (1000 * (long long)num_files) / best_time : 0) << " files/s, "
+		<< bytes << " bytes" << std::endl;
+}
+
+int main (int argc, char ** argv)
+{
+	wxInitializer initializer;
+	if (argc < 2 || !wxDirExists (argv[1]))
+	{
+		std::cout << "Usage: ingestbench directory [reads-in-flight] [rounds]" << std::endl;
+		return 1;
+	}
+	long max_reads = 64;
+	long rounds = 3;
+	if (argc > 2) wxString (argv[2]).ToLong (&max_reads);
+	if (argc > 3) wxString (argv[3]).ToLong (&rounds);
+
+	wxArrayString files;
+	wxDir::GetAllFiles (argv[1], &files);
+	std::cout << "Reading " << files.GetCount () << " files, "
+		<< max_reads << " reads in flight, best of " << rounds << " rounds" << std::endl;
+
+	for (int method = 0; method < 3; ++method)
+	{
+		long best_time = -1;
+		wxUint64 bytes = 0;
+		wxString name = "";
+		for (int round = 0; round < rounds; ++round)
+		{
+			wxStopWatch watch;
+			if (method == 0)
+			{
+				name = "one at a time";
+				bytes = readOneAtATime (files);
+			}
+			else
+			{
+				wxString loader_method;
+				bytes = readWithLoader (files, max_reads, method == 1, loader_method);
+				name = "loader (" + loader_method + ")";
+			}
+			long time = watch.Time ();
+			if (best_time < 0 || time < best_time) best_time = time;
+		}
+		report (name, best_time, files.GetCount (), bytes);
+	}
+	return 0;
+}
+
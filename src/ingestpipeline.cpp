@@ -0,0 +1,444 @@
+#include "ingestpipeline.h"
+
+// -- each stage thread runs one of the pipeline's stage methods
+class IngestPipeline::StageThread : public wxThread
+{
+	public:
+		StageThread (IngestPipeline & pipeline, bool prefetch)
+			: wxThread (wxTHREAD_JOINABLE), _pipeline (pipeline), _prefetch (prefetch)
+		{}
+		virtual void * Entry ()
+		{
+			if (_prefetch)
+				_pipeline.Prefetch ();
+			else
+				_pipeline.Tokenise ();
+			return NULL;
+		}
+	private:
+		IngestPipeline & _pipeline;
+		bool _prefetch;
+};
+
+// -- reads part of a buffer, reaching the end of the stream as a wxFileInputStream
+//    reaches the end of its file, so tokens are read just as from the file
+class BufferInputStream : public wxInputStream
+{
+	public:
+		BufferInputStream (const char * data, std::size_t size)
+			: _data (data), _size (size), _position (0)
+		{}
+	protected:
+		virtual size_t OnSysRead (void * buffer, size_t size)
+		{
+			if (_position >= _size)
+			{
+				m_lasterror = wxSTREAM_EOF;
+				return 0;
+			}
+			if (size > _size - _position) size = _size - _position;
+			memcpy (buffer, _data + _position, size);
+			_position += size;
+			return size;
+		}
+	private:
+		const char * _data;
+		std::size_t _size;
+		std::size_t _position;
+};
+
+// -- for sorting document indices, largest file first
+struct largerfilecmp
+{
+	largerfilecmp (const std::vector<wxULongLong> & sizes) : _sizes (sizes) {}
+	bool operator() (int x, int y) const
+	{
+		return _sizes[x] > _sizes[y];
+	}
+	const std::vector<wxULongLong> & _sizes;
+};
+
+// -- distinct trigrams, as three token indices
+typedef std::map<wxUint32, std::map<wxUint32, std::map<wxUint32, bool> > > TrigramMap;
+
+static void addTrigram (TrigramMap & found, std::vector<wxUint32> & trigrams, wxUint32 t0, wxUint32 t1, wxUint32 t2)
+{
+	bool & seen = found[t0][t1][t2];
+	if (seen) return;
+	seen = true;
+	trigrams.push_back (t0);
+	trigrams.push_back (t1);
+	trigrams.push_back (t2);
+}
+
+// -- queues hold enough work to keep every worker busy, and enough
+//    documents may be held to keep many file reads in flight
+IngestPipeline::IngestPipeline (DocumentList & documents, int num_workers)
+	: _documents (documents),
+	  _num_workers (num_workers < 1 ? 1 : num_workers),
+	  _first_document (0),
+	  _end_document (0),
+	  _chunk_size (1 << 20),
+	  _read_queue (2 * _num_workers),
+	  _tokenised_queue (2 * _num_workers),
+	  _added (_mutex),
+	  _num_waiting (0),
+	  _max_waiting (128 + 8 * _num_workers),
+	  _wall_time (0),
+	  _prefetch_time (0),
+	  _tokenise_time (0),
+	  _index_time (0)
+{}
+
+void IngestPipeline::Run (int first_document, int end_document)
+{
+	_first_document = first_document;
+	_end_document = end_document;
+	wxStopWatch watch;
+
+	std::vector<StageThread *> threads;
+	threads.push_back (new StageThread (* this, true));
+	for (int i = 0; i < _num_workers; ++i)
+	{
+		threads.push_back (new StageThread (* this, false));
+	}
+	for (int i = 0, n = threads.size (); i < n; ++i)
+	{
+		threads[i]->Create ();
+		threads[i]->Run ();
+	}
+
+	Index (); // -- the index stage is run on this thread
+
+	for (int i = 0, n = threads.size (); i < n; ++i)
+	{
+		threads[i]->Wait ();
+		delete threads[i];
+	}
+	_wall_time = watch.Time ();
+}
+
+// e.g. "Ingest: 1200 documents in 2.40s; prefetch (io_uring) 31% busy, 4 tokenisers 87% busy, index 22% busy"
+wxString IngestPipeline::GetReport () const
+{
+	long wall = (_wall_time < 1 ? 1 : _wall_time);
+	wxString report = "";
+	report.Printf ("Ingest: %d documents in %.2fs; prefetch (%s) %d%% busy, %d tokenisers %d%% busy, index %d%% busy",
+			_end_document - _first_document,
+			_wall_time / 1000.0,
+			(const char *) _load_method.mb_str (),
+			(int)(100 * _prefetch_time / wall),
+			_num_workers,
+			(int)(100 * _tokenise_time / (wall * _num_workers)),
+			(int)(100 * _index_time / wall));
+	return report;
+}
+
+// -- files are read by a FileLoader, largest first within each window of 
+//    _max_waiting documents, while documents not read as plain files are 
+//    passed straight on
+// -- as a window is no larger than the documents which may be held, the
+//    next document to index is always held or can be: sorting all the
+//    documents could leave the first until last, holding all the others
+// -- files found in the token cache skip the workers, going straight to 
+//    the index stage
+// -- prefetch is busy except when waiting for room to hold more documents
+void IngestPipeline::Prefetch ()
+{
+	std::vector<wxULongLong> sizes (_end_document, 0);
+	std::vector<int> order;
+	for (int i = _first_document; i < _end_document; ++i)
+	{
+		if (_documents[i]->IsPlainFile () && !_documents.IsDuplicate (i))
+		{
+			sizes[i] = wxFileName::GetSize (_documents[i]->GetPathname ());
+			if (sizes[i] == wxInvalidSize) sizes[i] = 0;
+		}
+		order.push_back (i);
+	}
+	for (std::size_t start = 0; start < order.size (); start += _max_waiting)
+	{
+		std::size_t end = std::min (start + _max_waiting, order.size ());
+		std::stable_sort (order.begin () + start, order.begin () + end, largerfilecmp (sizes));
+	}
+
+	FileLoader loader;
+	_load_method = loader.GetMethod ();
+	std::map<int, Item *> loading;
+	wxStopWatch watch;
+	std::size_t next = 0;
+	while (next < order.size () || loader.Size () > 0)
+	{
+		long start = watch.Time ();
+		Item * item = NULL;
+		if (next < order.size () && ReserveDocument (loader.Size () == 0))
+		{
+			start = watch.Time ();
+			item = new Item;
+			item->index = order[next];
+			item->direct = !_documents[item->index]->IsPlainFile () || _documents.IsDuplicate (item->index);
+			item->cached = false;
+			item->hash = 0;
+			item->length = 0;
+			if (!item->direct)
+			{
+				loader.Add (item->index, _documents[item->index]->GetPathname ());
+				loading[item->index] = item;
+				item = NULL;
+			}
+			next += 1;
+		}
+		else
+		{
+			int id;
+			bool ok;
+			std::vector<char> contents;
+			loader.WaitForNext (id, contents, ok);
+			item = loading[id];
+			loading.erase (id);
+			item->direct = !ok; // -- e.g. unreadable files are left to ReadDocument
+			item->contents.swap (contents);
+			item->cached = !item->direct && LookupCache (item);
+		}
+		AddBusyTime (_prefetch_time, watch.Time () - start);
+		if (item == NULL) continue;
+		if (item->cached)
+			_tokenised_queue.Push (item);
+		else
+			QueueChunks (item);
+	}
+	_read_queue.Close ();
+}
+
+// Count one more document as held in the pipeline, if there is room,
+// optionally waiting for room
+bool IngestPipeline::ReserveDocument (bool wait)
+{
+	wxMutexLocker lock (_mutex);
+	while (wait && _num_waiting >= _max_waiting) _added.Wait ();
+	if (_num_waiting >= _max_waiting) return false;
+	_num_waiting += 1;
+	return true;
+}
+
+// Hash the document's contents and look for its trigrams in the token cache,
+// if there is one, freeing the contents if they are found
+// -- the hash is kept to store the trigrams of a document not found
+bool IngestPipeline::LookupCache (Item * item)
+{
+	if (!_documents.UsesTokenCache ()) return false;
+	ContentHash hash;
+	if (!item->contents.empty ()) hash.Update (&item->contents[0], item->contents.size ());
+	item->hash = hash.GetHash ();
+	item->length = hash.GetLength ();
+	if (!_documents.LookupCachedTrigrams (item->index, item->hash, item->length, item->tokens, item->trigrams))
+	{
+		return false;
+	}
+	std::vector<char> ().swap (item->contents);
+	return true;
+}
+
+// Split the document's contents into chunks, and queue them for the workers
+// -- each chunk but the last is about _chunk_size, extended to a line end: 
+//    no reader's token spans a line end, so the tokens of the chunks are 
+//    those of the whole document
+// -- each chunk's reader is made by the worker tokenising it, see FindTrigrams
+void IngestPipeline::QueueChunks (Item * item)
+{
+	std::size_t start = 0;
+	std::size_t size = item->contents.size ();
+	do
+	{
+		std::size_t end = size;
+		if (size - start > _chunk_size)
+		{
+			end = start + _chunk_size;
+			while (end < size && item->contents[end - 1] != '\n') ++end;
+		}
+		Chunk * chunk = new Chunk;
+		chunk->item = item;
+		chunk->input = NULL;
+		chunk->reader = NULL;
+		if (!item->direct)
+		{
+			chunk->input = new BufferInputStream ((size == 0 ? NULL : &item->contents[start]), end - start);
+		}
+		item->chunks.push_back (chunk);
+		start = end;
+	}
+	while (start < size && !item->direct);
+
+	item->chunks_left = item->chunks.size ();
+	for (int i = 0, n = item->chunks.size (); i < n; ++i)
+	{
+		_read_queue.Push (item->chunks[i]);
+	}
+}
+
+// -- the worker tokenising a document's last chunk joins its chunks
+void IngestPipeline::Tokenise ()
+{
+	wxStopWatch watch;
+	Chunk * chunk;
+	while (_read_queue.Pop (chunk))
+	{
+		long start = watch.Time ();
+		if (chunk->input != NULL) FindTrigrams (chunk);
+		Item * item = chunk->item;
+		bool last_chunk;
+		{
+			wxMutexLocker lock (_mutex);
+			item->chunks_left -= 1;
+			last_chunk = (item->chunks_left == 0);
+		}
+		if (last_chunk)
+		{
+			if (!item->direct) JoinChunks (item);
+			for (int i = 0, n = item->chunks.size (); i < n; ++i) delete item->chunks[i];
+			item->chunks.clear ();
+		}
+		AddBusyTime (_tokenise_time, watch.Time () - start);
+		if (last_chunk) _tokenised_queue.Push (item);
+	}
+}
+
+// -- documents arrive in any order from the workers, and are held
+//    until all those before them have been added
+// -- each document's place in the pipeline is given up once it is added
+void IngestPipeline::Index ()
+{
+	wxStopWatch watch;
+	std::map<int, Item *> arrived;
+	int next = _first_document;
+	Item * item;
+	while (next < _end_document && _tokenised_queue.Pop (item))
+	{
+		arrived[item->index] = item;
+		std::map<int, Item *>::iterator it;
+		while ((it = arrived.find (next)) != arrived.end ())
+		{
+			item = it->second;
+			arrived.erase (it);
+			long start = watch.Time ();
+			if (item->direct)
+			{
+				_documents.ReadDocument (item->index);
+			}
+			else
+			{
+				_documents.AddReadTrigrams (item->index, item->tokens, item->trigrams,
+						item->cached, item->hash, item->length);
+			}
+			delete item;
+			AddBusyTime (_index_time, watch.Time () - start);
+			next += 1;
+			wxMutexLocker lock (_mutex);
+			_num_waiting -= 1;
+			_added.Signal ();
+		}
+	}
+}
+
+// Tokenise a chunk into its own TokenSet, noting its first and last two tokens
+// -- the reader is chosen from the document's type, which only reads its
+//    pathname, so workers may do so together, as the index stage reads others
+// -- token strings are copied out of the local TokenSet, so once the
+//    document is queued only the index stage refers to them
+void IngestPipeline::FindTrigrams (Chunk * chunk)
+{
+	chunk->reader = _documents[chunk->item->index]->CreateTokenReader (* chunk->input);
+	TokenSet tokens;
+	TrigramMap found;
+	std::size_t count = 0;
+	wxUint32 previous[2] = { 0, 0 };
+	while (chunk->reader->ReadToken ())
+	{
+		wxUint32 token = chunk->reader->GetToken (tokens);
+		if (count < 2)
+		{
+			chunk->first_tokens.push_back (token);
+		}
+		else
+		{
+			addTrigram (found, chunk->trigrams, previous[0], previous[1], token);
+		}
+		previous[0] = previous[1];
+		previous[1] = token;
+		count += 1;
+	}
+	if (count >= 2) chunk->last_tokens.push_back (previous[0]);
+	if (count >= 1) chunk->last_tokens.push_back (previous[1]);
+	delete chunk->reader;
+	delete chunk->input;
+	chunk->reader = NULL;
+	chunk->input = NULL;
+
+	for (std::size_t k = 0, n = tokens.Size (); k < n; ++k)
+	{
+		chunk->tokens.push_back (tokens.GetStringFor (k));
+	}
+}
+
+// Join the trigrams of the document's chunks, in order, and free the contents
+// -- the trigrams spanning a join start in the last two tokens before it, 
+//    and are found before those of the following chunk
+void IngestPipeline::JoinChunks (Item * item)
+{
+	if (item->chunks.size () == 1)
+	{
+		item->tokens.swap (item->chunks[0]->tokens);
+		item->trigrams.swap (item->chunks[0]->trigrams);
+	}
+	else
+	{
+		TokenSet tokens; // -- numbers the tokens of the whole document
+		TrigramMap found;
+		std::vector<wxUint32> tail; // -- last two tokens before the next chunk
+		for (int i = 0, n = item->chunks.size (); i < n; ++i)
+		{
+			Chunk * chunk = item->chunks[i];
+			std::vector<wxUint32> ids (chunk->tokens.size ());
+			for (std::size_t k = 0, m = chunk->tokens.size (); k < m; ++k)
+			{
+				ids[k] = tokens.GetIndexFor (chunk->tokens[k]);
+			}
+			std::vector<wxUint32> joined (tail);
+			for (std::size_t k = 0, m = chunk->first_tokens.size (); k < m; ++k)
+			{
+				joined.push_back (ids[chunk->first_tokens[k]]);
+			}
+			for (std::size_t k = 0; k < tail.size () && k + 2 < joined.size (); ++k)
+			{
+				addTrigram (found, item->trigrams, joined[k], joined[k+1], joined[k+2]);
+			}
+			for (std::size_t k = 0, m = chunk->trigrams.size (); k + 2 < m; k += 3)
+			{
+				addTrigram (found, item->trigrams, 
+						ids[chunk->trigrams[k]], ids[chunk->trigrams[k+1]], ids[chunk->trigrams[k+2]]);
+			}
+			if (chunk->last_tokens.size () == 2)
+			{
+				tail.clear ();
+				for (int k = 0; k < 2; ++k) tail.push_back (ids[chunk->last_tokens[k]]);
+			}
+			else // -- a chunk of under two tokens extends the tail
+			{
+				tail.swap (joined);
+				if (tail.size () > 2) tail.erase (tail.begin (), tail.end () - 2);
+			}
+		}
+		for (std::size_t k = 0, n = tokens.Size (); k < n; ++k)
+		{
+			item->tokens.push_back (tokens.GetStringFor (k));
+		}
+	}
+
+	std::vector<char> ().swap (item->contents);
+}
+
+void IngestPipeline::AddBusyTime (long & total, long time)
+{
+	wxMutexLocker lock (_mutex);
+	total += time;
+}
@@ -0,0 +1,113 @@
+#if !defined ingestpipeline_h
+#define ingestpipeline_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <algorithm>
+#include <map>
+#include <string.h>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/filename.h>
+#include <wx/stream.h>
+#include <wx/thread.h>
+
+#include "boundedqueue.h"
+#include "contenthash.h"
+#include "documentlist.h"
+#include "fileloader.h"
+#include "tokenreader.h"
+
+/** IngestPipeline reads the documents of a DocumentList in three stages,
+  * each on its own thread(s), joined by BoundedQueues:
+  *   prefetch -- finds the size of every file, then reads the contents of
+  *               files into memory, largest first within windows of the
+  *               document order, many at a time using a FileLoader
+  *   tokenise -- a number of workers, each taking the next piece of work
+  *               from a shared queue: the distinct trigrams of a document,
+  *               or of one chunk of a large document, numbered by a TokenSet
+  *               local to the piece
+  *   index    -- adds each document's trigrams to the DocumentList, in
+  *               document order, so tokens are numbered as if read one at a time
+  * -- large documents are split into chunks at line ends, so several workers
+  *    share them; the worker finishing a document's last chunk joins the
+  *    chunks' trigrams, adding those which span the joins
+  * -- starting with the largest documents means no worker is left with a
+  *    large document at the end of a window; the index stage holds documents 
+  *    tokenised out of order until those before them are added
+  * -- with a token cache, prefetch hashes each file and looks it up, passing
+  *    the trigrams of a file found there straight to the index stage
+  * -- documents not read as plain files (archive members, word-processor
+  *    files, streamed pdf files), and copies of earlier documents, are passed 
+  *    through, and read by the index stage with DocumentList::ReadDocument
+  * -- the queues are bounded, and prefetch stops while too many documents
+  *    are read but not yet added, so the contents and trigrams held stay bounded
+  * -- the time each stage spends working is recorded, for GetReport
+  */
+class IngestPipeline
+{
+	public:
+		IngestPipeline (DocumentList & documents, int num_workers);
+		// read documents first_document up to (not including) end_document
+		void Run (int first_document, int end_document);
+		// summary of how busy each stage was during Run
+		wxString GetReport () const;
+	private:
+		IngestPipeline (const IngestPipeline &);             // -- not copyable
+		IngestPipeline & operator= (const IngestPipeline &);
+		struct Chunk;
+		struct Item
+		{
+			int index;
+			bool direct;                    // -- read by the index stage
+			bool cached;                    // -- trigrams found in the token cache
+			std::vector<char> contents;     // -- the file, until tokenised
+			std::vector<Chunk *> chunks;
+			int chunks_left;                // -- chunks not yet tokenised
+			wxUint64 hash;                  // -- of the contents, if there is a token cache
+			wxUint64 length;
+			std::vector<wxString> tokens;   // -- every token, in order first seen
+			std::vector<wxUint32> trigrams; // -- three indices into tokens for each distinct trigram
+		};
+		struct Chunk
+		{
+			Item * item;
+			wxInputStream * input;          // -- NULL for a direct document
+			TokenReader * reader;           // -- made by the worker tokenising the chunk
+			std::vector<wxString> tokens;   // -- as for Item, within the chunk
+			std::vector<wxUint32> trigrams;
+			std::vector<wxUint32> first_tokens; // -- the first and last two tokens,
+			std::vector<wxUint32> last_tokens;  //    to find trigrams spanning joins
+		};
+		class StageThread;
+		friend class StageThread;
+		void Prefetch ();
+		void Tokenise ();
+		void Index ();
+		bool ReserveDocument (bool wait);
+		bool LookupCache (Item * item);
+		void QueueChunks (Item * item);
+		void FindTrigrams (Chunk * chunk);
+		void JoinChunks (Item * item);
+		void AddBusyTime (long & total, long time);
+		DocumentList &	_documents;
+		int		_num_workers;
+		int		_first_document;
+		int		_end_document;
+		std::size_t	_chunk_size;  // -- documents larger than this are split
+		BoundedQueue<Chunk *>	_read_queue;      // -- prefetch to tokenise
+		BoundedQueue<Item *>	_tokenised_queue; // -- tokenise to index
+		wxMutex		_mutex;       // -- guards the counts below, and chunks_left
+		wxCondition	_added;       // -- signalled as each document is added
+		int		_num_waiting; // -- documents read but not yet added
+		int		_max_waiting;
+		wxString	_load_method; // -- as used by the FileLoader
+		long		_wall_time;   // -- times in milliseconds
+		long		_prefetch_time;
+		long		_tokenise_time;
+		long		_index_time;
+};
+
+#endif
+
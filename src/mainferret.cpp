@@ -25,6 +25,11 @@ bool isAllComparisonsOption (wxString test_string)
 	return isNamedOption (test_string, "-a", "--all-comparisons");
 }
 
+bool isStatisticsOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-s", "--stats");
+}
+
 bool isRemoveCommonTrigramsOption (wxString test_string)
 {
 	return isNamedOption (test_string, "-r", "--remove-common");
@@ -50,33 +55,126 @@ bool isStoredDataOption (wxString test_string)
 	return isNamedOption (test_string, "-u", "--use-stored-data");
 }
 
+bool isIndexOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-i", "--use-index");
+}
+
+bool isTokenCacheOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-t", "--token-cache");
+}
+
+bool isNoExtractionCacheOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-n", "--no-extraction-cache");
+}
+
+bool isJobsOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-j", "--jobs");
+}
+
+bool isStreamPdfOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-e", "--stream-pdf");
+}
+
+bool isIngestWorkersOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-c", "--ingest-workers");
+}
+
+bool isOmitOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-o", "--omit");
+}
+
+bool isPathsFromStdinOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-z", "--paths-from-stdin");
+}
+
+bool isSegmentsOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-g", "--use-segments");
+}
+
+bool isCompactOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-k", "--compact-segments");
+}
+
+bool isMinHashOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-m", "--minhash");
+}
+
+bool isBandsOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-b", "--bands");
+}
+
+bool isWinnowOption (wxString test_string)
+{
+	return isNamedOption (test_string, "-w", "--winnow");
+}
+
 bool isCommandOption (wxString test_string)
 {
 	return isHelpOption (test_string) 
 		|| isDataTableOption (test_string) 
 		|| isListTrigramsOption (test_string) 
 		|| isAllComparisonsOption (test_string) 
+		|| isStatisticsOption (test_string)
     || isRemoveCommonTrigramsOption (test_string)
 		|| isPdfOption (test_string)
 		|| isXmlOption (test_string)
 		|| isDefinitionOption (test_string)
-		|| isStoredDataOption (test_string);
+		|| isStoredDataOption (test_string)
+		|| isIndexOption (test_string)
+		|| isTokenCacheOption (test_string)
+		|| isNoExtractionCacheOption (test_string)
+		|| isJobsOption (test_string)
+		|| isStreamPdfOption (test_string)
+		|| isIngestWorkersOption (test_string)
+		|| isOmitOption (test_string)
+		|| isPathsFromStdinOption (test_string)
+		|| isSegmentsOption (test_string)
+		|| isCompactOption (test_string)
+		|| isMinHashOption (test_string)
+		|| isBandsOption (test_string)
+		|| isWinnowOption (test_string);
 }
 
 void aboutMessage ()
 {
 	std::cout 
 		<< "Ferret 5.4: start with no arguments for graphical version" << std::endl
-		<< "Usage: ferret [-h] [-d] [-l] [-a] [-r] [-p] [-x] [-f] [-u]" << std::endl
+		<< "Usage: ferret [-h] [-d] [-l] [-a] [-s] [-r] [-p] [-x] [-f] [-u] [-i] [-t] [-n] [-j] [-e] [-c] [-o] [-z] [-g] [-k] [-m] [-b] [-w]" << std::endl
 		<< "  -h, --help           	displays help on command-line parameters" << std::endl
 		<< "  -d, --data-table     	produce similarity table (default)" << std::endl
 		<< "  -l, --list-trigrams  	produce trigram list report" << std::endl
 		<< "  -a, --all-comparisons	produce list of all comparisons" << std::endl
+		<< "  -s, --stats          	produce summary statistics of similarities" << std::endl
     << "  -r, --remove-common   removes common trigrams" << std::endl
 		//<< "  -p, --pdf-report     	source-1 source-2 results-file : create pdf report" << std::endl
 		<< "  -x, --xml-report     	source-1 source-2 results-file : create xml report" << std::endl
 		<< "  -f, --definition-file	use file with document list" << std::endl
-		<< "  -u, --use-stored-data	store/retrieve data structure" << std::endl;
+		<< "  -u, --use-stored-data	store/retrieve data structure" << std::endl
+		<< "  -i, --use-index      	create, or compare against, a read-only index" << std::endl
+		<< "  -t, --token-cache    	reuse trigrams of unchanged files, kept in given folder" << std::endl
+		<< "  -n, --no-extraction-cache	convert pdf/word-processor files without the cache" << std::endl
+		<< "  -j, --jobs           	number of pdf/word-processor conversions to run at once" << std::endl
+		<< "  -e, --stream-pdf     	read pdf text straight from pdftotext, without a text file" << std::endl
+		<< "  -c, --ingest-workers 	number of threads tokenising files, overlapped with reading and indexing" << std::endl
+		<< "  -o, --omit           	skip files and folders matching given pattern, in folders (may be repeated)" << std::endl
+		<< "  -z, --paths-from-stdin	also read paths from standard input, separated by NUL, as from find -print0" << std::endl
+		<< "  -g, --use-segments   	retrieve data from, and add a segment to, a store directory" << std::endl
+		<< "  -k, --compact-segments	merge the segments in a store directory" << std::endl
+		<< "  -m, --minhash        	estimate resemblance from signatures of given number of hashes, e.g. 128" << std::endl
+		<< "  -b, --bands          	compare exactly only pairs whose signatures agree in one of given number of bands" << std::endl
+		<< "  -w, --winnow         	index only fingerprints, one in each window of given number of trigrams" << std::endl;
 }
 
 void produceComparisonReport (
@@ -84,10 +182,12 @@ void produceComparisonReport (
 		wxString filename2, 
 		wxString target_name,
 		Report report_type,
-    bool remove_common_trigrams
+    bool remove_common_trigrams,
+		int winnow_window
 		)
 {
 	DocumentList docs;
+	docs.SetWinnowing (winnow_window);
 	if (wxFileName::IsFileReadable (filename1))
 		docs.AddDocument (filename1);
 	if (wxFileName::IsFileReadable (filename2))
@@ -132,6 +232,7 @@ void writeTrigramList (DocumentList & docs)
 	}
 }
 
+// -- pairs of documents in the same group are not compared, so are shown as "-"
 void writeAllComparisons (DocumentList & docs, bool remove_common_trigrams)
 {
 	// output the headings
@@ -149,6 +250,8 @@ void writeAllComparisons (DocumentList & docs, bool remove_common_trigrams)
 			std::cout << ", ";
 			if (i == j)
 				std::cout << "1.0";
+			else if (docs.GetGroupId (i) == docs.GetGroupId (j))
+				std::cout << "-";
 			else if (i < j) // resemblance is symmetric, and assumes i < j
 				std::cout << docs.ComputeResemblance (i, j, remove_common_trigrams);
 			else
@@ -158,32 +261,92 @@ void writeAllComparisons (DocumentList & docs, bool remove_common_trigrams)
 	}
 }
 
+// output one line of the similarity table, for documents i < j
+void writeSimilarity (DocumentList & docs, int i, int j, bool remove_common_trigrams)
+{
+	std::cout 
+		<< docs[i]->GetPathname () << " ; "
+		<< docs[j]->GetPathname () << " ; "
+		<< docs.CountMatches (i, j, remove_common_trigrams) << " ; "
+		<< docs.CountTrigrams (i) << " ; " 
+		<< docs.CountTrigrams (j) << " ; "
+		<< docs.ComputeResemblance (i, j, remove_common_trigrams)
+		<< std::endl;
+}
+
 void writeSimilarityTable (DocumentList & docs, bool remove_common_trigrams) 
 {
 	// output the data
 	std::cout << "Number of documents: " << docs.Size () << std::endl;
-	std::cout << "Number of distinct trigrams: " << docs.GetTotalTrigramCount () << std::endl;
+	if (docs.IsApproximate ())
+	{
+		std::cout << "Similarity estimated from MinHash signatures" << std::endl;
+	}
+	else
+	{
+		std::cout << "Number of distinct trigrams: " << docs.GetTotalTrigramCount () << std::endl;
+	}
   if (remove_common_trigrams)
   {
     std::cout << "Similarity measure removes trigrams common to other files" << std::endl;
   }
+	if (docs.UsesCandidates ())
+	{ // only output the candidate pairs, as all others have no matches
+		std::vector<int> document1;
+		std::vector<int> document2;
+		docs.GetCandidatePairs (document1, document2);
+		std::cout << "Candidate pairs compared: " << document1.size () << " of " << docs.NumberOfPairs () << std::endl;
+		for (int k = 0, n = document1.size (); k < n; ++k)
+		{
+			writeSimilarity (docs, document1[k], document2[k], remove_common_trigrams);
+		}
+		return;
+	}
 	for (int i=0; i<docs.Size(); ++i)
 		for (int j=i+1; j<docs.Size(); ++j)
 		{
-			if (docs[i]->GetGroupId () != docs[j]->GetGroupId ())
+			if (docs.GetGroupId (i) != docs.GetGroupId (j))
 			{ // only output result if not in same group
-				std::cout 
-					<< docs[i]->GetPathname () << " ; "
-					<< docs[j]->GetPathname () << " ; "
-					<< docs.CountMatches (i, j, remove_common_trigrams) << " ; "
-					<< docs.CountTrigrams (i) << " ; " 
-					<< docs.CountTrigrams (j) << " ; "
-					<< docs.ComputeResemblance (i, j, remove_common_trigrams)
-					<< std::endl;
+				writeSimilarity (docs, i, j, remove_common_trigrams);
 			}
 		}
 }
 
+// Write mean, variance and percentiles of similarity for each similarity measure,
+// followed by a histogram of the similarities
+void writeStatistics (DocumentList & docs)
+{
+	const CorpusStatistics & statistics = docs.GetStatistics ();
+	const char * names[4] = {"all", "remove-common", "ignore-template", "remove-common+ignore-template"};
+
+	std::cout << "Number of documents: " << docs.Size () << std::endl;
+	std::cout << "Number of pairs: " << docs.NumberOfPairs () << std::endl;
+	std::cout << "measure ; mean ; variance ; median ; 90% ; 99% ; max" << std::endl;
+	for (int k = 0; k < 4; ++k)
+	{
+		const SimilaritySummary & summary = statistics.GetSummary (k & 1, k & 2);
+		std::cout 
+			<< names[k] << " ; "
+			<< summary.GetMean () << " ; "
+			<< summary.GetVariance () << " ; "
+			<< summary.GetPercentile (50) << " ; "
+			<< summary.GetPercentile (90) << " ; "
+			<< summary.GetPercentile (99) << " ; "
+			<< summary.GetMaximum ()
+			<< std::endl;
+	}
+	std::cout << "histogram ; all ; remove-common ; ignore-template ; remove-common+ignore-template" << std::endl;
+	for (int bin = 0; bin < SimilaritySummary::NUM_BINS; ++bin)
+	{
+		std::cout << (float)bin / SimilaritySummary::NUM_BINS;
+		for (int k = 0; k < 4; ++k)
+		{
+			std::cout << " ; " << statistics.GetSummary (k & 1, k & 2).GetBinCount (bin);
+		}
+		std::cout << std::endl;
+	}
+}
+
 // Note this must return false if the command-line operation has completed
 // -- in wxWidgets returning false from OnInit ceases the application
 // This returns true if no command-line options provided, and the application
@@ -205,7 +368,16 @@ bool FerretApp::OnInit ()
 		int filenames_start = 1; 		// index within argv of first filename
 		wxString definition_file = "";	// string to hold path to definition file
 		wxString stored_data = "";		// string to hold path to stored data
+		wxString index_file = "";		// string to hold path to read-only index
+		wxString segments_dir = "";		// string to hold path to segmented store
+		wxString token_cache_dir = "";	// string to hold path to token cache
 		wxString upload_dir = "";		// string to hold path to upload_dir, for html-table
+		long ingest_workers = 0;		// tokenising threads in the ingest pipeline, 0 for none
+		wxArrayString omit_patterns;	// patterns of names to skip when adding folders
+		bool paths_from_stdin = false;	// flag to read further paths from standard input
+		long minhash_hashes = 0;		// hashes in each MinHash signature, 0 for exact similarities
+		long num_bands = 0;			// bands of hashes finding candidate pairs, 0 to compare all pairs
+		long winnow_window = 0;		// trigrams in each winnowing window, 0 to index every trigram
     bool remove_common_trigrams = false; // flag to change type of similarity measure used
 
 		// work through command options, leaving filenames_start pointing at next argument
@@ -231,6 +403,11 @@ bool FerretApp::OnInit ()
 				report_type = ALL_COMPARISONS;
 				filenames_start += 1;
 			}
+			else if (isStatisticsOption (argv[filenames_start]))
+			{
+				report_type = STATISTICS;
+				filenames_start += 1;
+			}
       else if (isRemoveCommonTrigramsOption (argv[filenames_start]))
       {
         remove_common_trigrams = true;
@@ -257,12 +434,91 @@ bool FerretApp::OnInit ()
 				stored_data = argv[filenames_start+1];
 				filenames_start += 2;
 			}
+			else if (isIndexOption (argv[filenames_start]))
+			{
+				index_file = argv[filenames_start+1];
+				filenames_start += 2;
+			}
+			else if (isTokenCacheOption (argv[filenames_start]))
+			{
+				token_cache_dir = argv[filenames_start+1];
+				filenames_start += 2;
+			}
+			else if (isNoExtractionCacheOption (argv[filenames_start]))
+			{
+				wxGetApp().SetBypassExtractionCache (true);
+				filenames_start += 1;
+			}
+			else if (isJobsOption (argv[filenames_start]))
+			{
+				long processes = 1;
+				wxString (argv[filenames_start+1]).ToLong (&processes);
+				wxGetApp().SetConversionProcesses (processes);
+				filenames_start += 2;
+			}
+			else if (isStreamPdfOption (argv[filenames_start]))
+			{
+				wxGetApp().SetStreamPdf (true);
+				filenames_start += 1;
+			}
+			else if (isIngestWorkersOption (argv[filenames_start]))
+			{
+				ingest_workers = 0;
+				wxString (argv[filenames_start+1]).ToLong (&ingest_workers);
+				filenames_start += 2;
+			}
+			else if (isOmitOption (argv[filenames_start]))
+			{
+				omit_patterns.Add (argv[filenames_start+1]);
+				filenames_start += 2;
+			}
+			else if (isPathsFromStdinOption (argv[filenames_start]))
+			{
+				paths_from_stdin = true;
+				filenames_start += 1;
+			}
+			else if (isSegmentsOption (argv[filenames_start]))
+			{
+				segments_dir = argv[filenames_start+1];
+				filenames_start += 2;
+			}
+			else if (isMinHashOption (argv[filenames_start]))
+			{
+				minhash_hashes = 0;
+				wxString (argv[filenames_start+1]).ToLong (&minhash_hashes);
+				filenames_start += 2;
+			}
+			else if (isBandsOption (argv[filenames_start]))
+			{
+				num_bands = 0;
+				wxString (argv[filenames_start+1]).ToLong (&num_bands);
+				filenames_start += 2;
+			}
+			else if (isWinnowOption (argv[filenames_start]))
+			{
+				winnow_window = 0;
+				wxString (argv[filenames_start+1]).ToLong (&winnow_window);
+				filenames_start += 2;
+			}
+			else if (isCompactOption (argv[filenames_start]))
+			{
+				// compaction needs no other files, so is done straight away
+				DocumentList docs;
+				if (!docs.CompactSegments (argv[filenames_start+1]))
+				{
+					std::cout << "Could not compact segments in: " << argv[filenames_start+1] << std::endl;
+				}
+				return false;
+			}
 		}
 
+		// -- bands are taken from the signatures, of 128 hashes unless given
+		if (num_bands > 0 && minhash_hashes <= 0) minhash_hashes = 128;
+
 		// -- carry out required action
 		int num_filenames = argc - filenames_start;
 		// ---- first check error conditions, basically insufficient files or bad report option
-		if ( (num_filenames < 2 && definition_file.IsEmpty () && stored_data.IsEmpty ()) ||	
+		if ( (num_filenames < 2 && definition_file.IsEmpty () && stored_data.IsEmpty () && index_file.IsEmpty () && segments_dir.IsEmpty () && !paths_from_stdin) ||	
 				(report_type == PDF_REPORT && num_filenames != 3) ||
 				(report_type == XML_REPORT && num_filenames != 3))
 		{	// not enough filenames, or incorrect use of PDF/XML_REPORT option
@@ -275,13 +531,34 @@ bool FerretApp::OnInit ()
 					argv[filenames_start+1],
 				        argv[filenames_start+2],	
 					report_type,
-          remove_common_trigrams
+          remove_common_trigrams,
+					winnow_window
 					);
 			return false;
 		}
+		else if (minhash_hashes > 0 && 
+				(!stored_data.IsEmpty () || !index_file.IsEmpty () || !segments_dir.IsEmpty () || 
+				 (report_type == LIST_TRIGRAMS && num_bands == 0)))
+		{	// signatures are not stored, and are not indexed trigrams, so cannot be listed
+			std::cout << "MinHash signatures cannot be used with stored data, an index, segments or a trigram list" << std::endl;
+			return false;
+		}
+		else if (winnow_window > 0 && 
+				(!stored_data.IsEmpty () || !index_file.IsEmpty () || !segments_dir.IsEmpty ()))
+		{	// the window is not stored, so fingerprints could be mixed with other trigrams
+			std::cout << "Winnowing cannot be used with stored data, an index or segments" << std::endl;
+			return false;
+		}
 		else // other report options are similar, needing ferret to run on all files
 		{
 			DocumentList docs;
+			docs.SetMinHash (minhash_hashes);
+			docs.SetCandidateBands (num_bands);
+			docs.SetWinnowing (winnow_window);
+			for (int i = 0; i < omit_patterns.GetCount (); ++i)
+			{
+				docs.AddIgnorePattern (omit_patterns[i]);
+			}
 			int num_preloaded_documents = 0;
 			// optionally, retrieve documentlist from store
 			if (!stored_data.IsEmpty ())
@@ -290,6 +567,27 @@ bool FerretApp::OnInit ()
 				num_preloaded_documents = docs.Size ();
 				// TODO: catch 'false' return to indicate failure
 			}
+			// or open an existing index, which is used in place and not changed
+			bool index_exists = !index_file.IsEmpty () && wxFile::Exists (index_file);
+			if (index_exists)
+			{
+				if (!docs.OpenIndex (index_file))
+				{
+					std::cout << "Could not read index: " << index_file << std::endl;
+					return false;
+				}
+				num_preloaded_documents = docs.Size ();
+			}
+			// or retrieve the segments of a store directory
+			if (!segments_dir.IsEmpty ())
+			{
+				if (!docs.RetrieveSegments (segments_dir))
+				{
+					std::cout << "Could not read segments in: " << segments_dir << std::endl;
+					return false;
+				}
+				num_preloaded_documents = docs.Size ();
+			}
 			// add in provided input files
 			// -- from definition file, if provided
 			if (wxFileName::IsFileReadable (definition_file))
@@ -297,6 +595,7 @@ bool FerretApp::OnInit ()
 				docs.AddDocumentsFromDefinitionFile (definition_file);
 			}
 			// -- and any remaining filenames on command line
+			//    zip/tar archives are read like directories, without grouping
 			for (int i = filenames_start; i < argc; ++i)
 			{
 				if (wxFileName::IsFileReadable (argv[i]))
@@ -304,6 +603,11 @@ bool FerretApp::OnInit ()
 					docs.AddDocument (argv[i]);
 				}
 			}
+			// -- and any paths given on standard input
+			if (paths_from_stdin)
+			{
+				docs.AddDocumentsFromPathList (std::cin);
+			}
 
 			if (docs.Size () < 2) // check we added at least 2 readable files
 			{
@@ -312,14 +616,31 @@ bool FerretApp::OnInit ()
 			}
 
 			std::vector<Document *> to_remove; // keep a list of documents not to be processed
-			// make sure every document has its text extracted
-			for (int i = 0, n = docs.Size(); i < n; ++i)
+			// make sure every new document has its text extracted
+			// -- converters are run in a pool, finishing each document as its converter completes
+			ConversionPool pool (wxGetApp().GetConversionProcesses (), wxGetApp().GetConversionTimeout ());
+			wxString extract_folder = wxGetApp().GetExtractFolder ();
+			for (int i = num_preloaded_documents, n = docs.Size(); i < n; ++i)
 			{
-				wxString extract_folder = wxGetApp().GetExtractFolder ();
-				if (!docs[i]->ExtractDocument (extract_folder, i))
+				wxArrayString command;
+				if (!docs[i]->StartExtraction (extract_folder, i, command))
 				{
 					to_remove.push_back (docs[i]);
 				}
+				else if (command.IsEmpty ())
+				{
+					if (!docs[i]->FinishExtraction (true)) to_remove.push_back (docs[i]);
+				}
+				else
+				{
+					pool.Add (i, command);
+				}
+			}
+			int id;
+			bool finished;
+			while (pool.WaitForNext (id, finished))
+			{
+				if (!docs[id]->FinishExtraction (finished)) to_remove.push_back (docs[id]);
 			}
 			// remove unwanted or failed documents
 			for (int i = 0, n = to_remove.size(); i < n; ++i)
@@ -327,7 +648,33 @@ bool FerretApp::OnInit ()
 				docs.RemoveDocument (to_remove[i]);
 			}
 
+			TokenCache * token_cache = NULL;
+			if (!token_cache_dir.IsEmpty ())
+			{
+				token_cache = new TokenCache (token_cache_dir);
+				docs.SetTokenCache (token_cache);
+			}
+
+			docs.SetIngestWorkers (ingest_workers);
 			docs.RunFerret (num_preloaded_documents);
+			if (!docs.GetIngestReport ().IsEmpty ())
+			{
+				std::cerr << docs.GetIngestReport () << std::endl;
+			}
+			if (docs.CountDuplicates () > 0)
+			{
+				std::cerr << "Duplicates: " << docs.CountDuplicates () 
+					<< " files the same as earlier files, not read" << std::endl;
+			}
+
+			// report use of cache on error stream, to keep it out of the reports
+			if (token_cache != NULL)
+			{
+				std::cerr << "Token cache: " << token_cache->GetHits () << " hits, " 
+					<< token_cache->GetMisses () << " misses" << std::endl;
+				docs.SetTokenCache (NULL);
+				delete token_cache;
+			}
 
 			// report output, based on report type
 			if (report_type == LIST_TRIGRAMS) 
@@ -342,11 +689,25 @@ bool FerretApp::OnInit ()
 			{
 				writeSimilarityTable (docs, remove_common_trigrams);
 			}
+			else if (report_type == STATISTICS)
+			{
+				writeStatistics (docs);
+			}
 			// optionally save out the document table
 			if (!stored_data.IsEmpty ())
 			{
 				docs.SaveDocumentList (stored_data);
 			}
+			// or add a segment with the new documents
+			if (!segments_dir.IsEmpty ())
+			{
+				docs.AppendSegment (segments_dir);
+			}
+			// create the index, if not already present
+			if (!index_file.IsEmpty () && !index_exists)
+			{
+				docs.SaveIndex (index_file);
+			}
 		}
 		return false; // stops application, as successful
 	}
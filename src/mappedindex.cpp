@@ -0,0 +1,401 @@
+#include "mappedindex.h"
+#include "binaryio.h"
+#include "tokenset.h"
+#include "tupleset.h"
+
+#include <algorithm>
+#include <string>
+#if __UNIX__
+#include <sys/mman.h>
+#endif
+
+const char INDEX_MAGIC[] = "FERRETIX";
+const wxUint32 INDEX_VERSION = 1;
+const int INDEX_HEADER_SIZE = 104;
+
+// positions of fields within header
+enum IndexHeader {
+	NUM_TOKENS = 16,
+	NUM_TUPLES = 24,
+	TOKEN_OFFSETS = 32,
+	TOKEN_ORDER = 40,
+	TOKEN_STRINGS = 48,
+	TUPLE_KEYS = 56,
+	TUPLE_POSTINGS = 64,
+	DOCUMENT_IDS = 72,
+	TUPLE_FLAGS = 80,
+	DOCUMENTS = 88,
+	HEADER_CRC = 96
+};
+
+// for sorting token ids by the bytes of their strings
+struct tokenbytescmp {
+	tokenbytescmp (const std::vector<std::string> & strings) : _strings (strings) {}
+	const std::vector<std::string> & _strings;
+
+	bool operator()(wxUint32 x, wxUint32 y) const
+	{
+		return _strings[x] < _strings[y];
+	}
+};
+
+static void PutUInt64 (wxUint8 * bytes, wxUint64 n)
+{
+	for (int i = 0; i < 8; ++i)
+	{
+		bytes[i] = (wxUint8)(n >> (8 * i));
+	}
+}
+
+// pad the file with zeros to a multiple of 8 bytes, and return the position
+static wxFileOffset AlignOutput (BinaryWriter & output, wxFile & file)
+{
+	output.Flush ();
+	wxFileOffset position = file.Tell ();
+	while (position % 8 != 0)
+	{
+		output.WriteByte (0);
+		position += 1;
+	}
+	output.Flush ();
+	return position;
+}
+
+MappedIndex::MappedIndex ()
+	: _data (NULL),
+	  _length (0),
+	  _is_mapped (false),
+	  _num_tokens (0),
+	  _num_tuples (0)
+{}
+
+MappedIndex::~MappedIndex ()
+{
+	Close ();
+}
+
+// Write the header and arrays for the tokens and tuples.
+// The header is written last, once the position of each array is known.
+bool MappedIndex::Write (wxFile & file, TokenSet & tokenset, TupleSet & tupleset)
+{
+	wxUint8 header[INDEX_HEADER_SIZE];
+	memset (header, 0, INDEX_HEADER_SIZE);
+	BinaryWriter output (file);
+	output.WriteBytes (header, INDEX_HEADER_SIZE);
+
+	// -- tokens
+	std::vector<std::string> strings;
+	std::vector<wxUint32> order;
+	for (std::size_t i = 0, n = tokenset.Size (); i < n; ++i)
+	{
+		const wxCharBuffer utf8 = tokenset.GetStringFor (i).utf8_str ();
+		strings.push_back (std::string (utf8.data ()));
+		order.push_back (i);
+	}
+	std::sort (order.begin (), order.end (), tokenbytescmp (strings));
+
+	PutUInt64 (header + NUM_TOKENS, strings.size ());
+	PutUInt64 (header + TOKEN_OFFSETS, AlignOutput (output, file));
+	wxUint64 offset = 0;
+	for (std::size_t i = 0; i < strings.size (); ++i)
+	{
+		output.WriteUInt64 (offset);
+		offset += strings[i].size ();
+	}
+	output.WriteUInt64 (offset);
+	PutUInt64 (header + TOKEN_ORDER, AlignOutput (output, file));
+	for (std::size_t i = 0; i < order.size (); ++i)
+	{
+		output.WriteUInt32 (order[i]);
+	}
+	PutUInt64 (header + TOKEN_STRINGS, AlignOutput (output, file));
+	for (std::size_t i = 0; i < strings.size (); ++i)
+	{
+		output.WriteBytes (strings[i].data (), strings[i].size ());
+	}
+
+	// -- tuples, in one pass over the tupleset per array
+	PutUInt64 (header + TUPLE_KEYS, AlignOutput (output, file));
+	wxUint64 num_tuples = 0;
+	for (tupleset.Begin (); tupleset.HasMore (); tupleset.GetNext ())
+	{
+		output.WriteUInt32 (tupleset.GetToken (0));
+		output.WriteUInt32 (tupleset.GetToken (1));
+		output.WriteUInt32 (tupleset.GetToken (2));
+		num_tuples += 1;
+	}
+	PutUInt64 (header + NUM_TUPLES, num_tuples);
+	PutUInt64 (header + TUPLE_POSTINGS, AlignOutput (output, file));
+	offset = 0;
+	for (tupleset.Begin (); tupleset.HasMore (); tupleset.GetNext ())
+	{
+		output.WriteUInt64 (offset);
+		offset += tupleset.GetDocumentsForCurrentTuple().size ();
+	}
+	output.WriteUInt64 (offset);
+	PutUInt64 (header + DOCUMENT_IDS, AlignOutput (output, file));
+	std::vector<int> docs;
+	for (tupleset.Begin (); tupleset.HasMore (); tupleset.GetNext ())
+	{
+		docs = tupleset.GetDocumentsForCurrentTuple ();
+		std::sort (docs.begin (), docs.end ());
+		for (int i = 0, n = docs.size (); i < n; ++i)
+		{
+			output.WriteUInt32 (docs[i]);
+		}
+	}
+	PutUInt64 (header + TUPLE_FLAGS, AlignOutput (output, file));
+	for (tupleset.Begin (); tupleset.HasMore (); tupleset.GetNext ())
+	{
+		output.WriteByte (tupleset.IsTemplateForCurrentTuple () ? 1 : 0);
+	}
+	wxFileOffset end = AlignOutput (output, file);
+	PutUInt64 (header + DOCUMENTS, end);
+
+	// -- header
+	memcpy (header, INDEX_MAGIC, 8);
+	header[8] = INDEX_VERSION;
+	wxUint32 crc = UpdateCrc32 (0, header, HEADER_CRC);
+	for (int i = 0; i < 4; ++i)
+	{
+		header[HEADER_CRC + i] = (wxUint8)(crc >> (8 * i));
+	}
+	file.Seek (0);
+	output.WriteBytes (header, INDEX_HEADER_SIZE);
+	output.Flush ();
+	file.Seek (end);
+
+	return !output.HasError ();
+}
+
+// Map the file into memory, and check the header and sizes of the arrays
+bool MappedIndex::Open (wxString path)
+{
+	Close ();
+	wxFile file;
+	if (!file.Open (path, wxFile::read)) return false;
+	_length = file.Length ();
+	if (_length < INDEX_HEADER_SIZE) return false;
+
+#if __UNIX__
+	void * data = mmap (NULL, _length, PROT_READ, MAP_SHARED, file.fd (), 0);
+	if (data != MAP_FAILED)
+	{
+		_data = (const wxUint8 *)data;
+		_is_mapped = true;
+	}
+#endif
+	if (_data == NULL) // no mapping, so read whole file
+	{
+		wxUint64 * buffer = new wxUint64 [(_length + 7) / 8]; // aligned for arrays
+		if (file.Read (buffer, _length) != _length)
+		{
+			delete[] buffer;
+			return false;
+		}
+		_data = (const wxUint8 *)buffer;
+		_is_mapped = false;
+	}
+
+	bool ok = (memcmp (_data, INDEX_MAGIC, 8) == 0) &&
+		(ReadUInt32 (8) == INDEX_VERSION) &&
+		(ReadUInt32 (HEADER_CRC) == UpdateCrc32 (0, _data, HEADER_CRC));
+	if (ok)
+	{
+		_num_tokens = ReadUInt64 (NUM_TOKENS);
+		_num_tuples = ReadUInt64 (NUM_TUPLES);
+		wxUint64 positions[] = {
+			ReadUInt64 (TOKEN_OFFSETS), ReadUInt64 (TOKEN_ORDER), ReadUInt64 (TOKEN_STRINGS),
+			ReadUInt64 (TUPLE_KEYS), ReadUInt64 (TUPLE_POSTINGS), ReadUInt64 (DOCUMENT_IDS),
+			ReadUInt64 (TUPLE_FLAGS), ReadUInt64 (DOCUMENTS) };
+		for (int i = 0; i < 8; ++i)
+		{
+			if (positions[i] % 8 != 0 || positions[i] > (wxUint64)_length) ok = false;
+		}
+		if (ok)
+		{
+			_token_offsets = (const wxUint64 *)(_data + positions[0]);
+			_token_order = (const wxUint32 *)(_data + positions[1]);
+			_token_strings = (const char *)(_data + positions[2]);
+			_tuple_keys = (const wxUint32 *)(_data + positions[3]);
+			_tuple_postings = (const wxUint64 *)(_data + positions[4]);
+			_document_ids = (const wxUint32 *)(_data + positions[5]);
+			_tuple_flags = _data + positions[6];
+			_documents_position = positions[7];
+			// check each array fits before the next one
+			ok = positions[0] + 8 * (_num_tokens + 1) <= positions[1] &&
+				positions[1] + 4 * _num_tokens <= positions[2] &&
+				positions[2] + wxUINT64_SWAP_ON_BE (_token_offsets[_num_tokens]) <= positions[3] &&
+				positions[3] + 12 * _num_tuples <= positions[4] &&
+				positions[4] + 8 * (_num_tuples + 1) <= positions[5] &&
+				positions[5] + 4 * wxUINT64_SWAP_ON_BE (_tuple_postings[_num_tuples]) <= positions[6] &&
+				positions[6] + _num_tuples <= positions[7];
+		}
+	}
+	if (!ok) Close ();
+	return ok;
+}
+
+void MappedIndex::Close ()
+{
+	if (_data != NULL)
+	{
+#if __UNIX__
+		if (_is_mapped) munmap ((void *)_data, _length);
+#endif
+		if (!_is_mapped) delete[] (wxUint64 *)_data;
+	}
+	_data = NULL;
+	_length = 0;
+	_num_tokens = 0;
+	_num_tuples = 0;
+}
+
+bool MappedIndex::IsOpen () const
+{
+	return _data != NULL;
+}
+
+wxFileOffset MappedIndex::GetDocumentsPosition () const
+{
+	return _documents_position;
+}
+
+std::size_t MappedIndex::GetTokenCount () const
+{
+	return _num_tokens;
+}
+
+wxString MappedIndex::GetTokenString (std::size_t token) const
+{
+	assert (token < _num_tokens);
+	wxUint64 start = wxUINT64_SWAP_ON_BE (_token_offsets[token]);
+	wxUint64 end = wxUINT64_SWAP_ON_BE (_token_offsets[token+1]);
+	return wxString::FromUTF8 (_token_strings + start, end - start);
+}
+
+// compare bytes of given token with given bytes, as in strcmp
+int MappedIndex::CompareToken (wxUint32 token, const char * bytes, size_t length) const
+{
+	wxUint64 start = wxUINT64_SWAP_ON_BE (_token_offsets[token]);
+	size_t token_length = wxUINT64_SWAP_ON_BE (_token_offsets[token+1]) - start;
+	int cmp = memcmp (_token_strings + start, bytes, std::min (token_length, length));
+	if (cmp != 0) return cmp;
+	if (token_length == length) return 0;
+	return (token_length < length ? -1 : 1);
+}
+
+// binary search through tokens sorted by their bytes
+bool MappedIndex::FindToken (const wxString & token, std::size_t & index) const
+{
+	const wxCharBuffer utf8 = token.utf8_str ();
+	size_t length = strlen (utf8.data ());
+	std::size_t low = 0;
+	std::size_t high = _num_tokens;
+	while (low < high)
+	{
+		std::size_t mid = low + (high - low) / 2;
+		wxUint32 candidate = wxUINT32_SWAP_ON_BE (_token_order[mid]);
+		int cmp = CompareToken (candidate, utf8.data (), length);
+		if (cmp == 0)
+		{
+			index = candidate;
+			return true;
+		}
+		else if (cmp < 0)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return false;
+}
+
+std::size_t MappedIndex::GetTupleCount () const
+{
+	return _num_tuples;
+}
+
+std::size_t MappedIndex::GetToken (std::size_t tuple, int i) const
+{
+	assert (tuple < _num_tuples && i >= 0 && i <= 2);
+	return wxUINT32_SWAP_ON_BE (_tuple_keys[3 * tuple + i]);
+}
+
+// binary search through the sorted tuple keys
+bool MappedIndex::FindTuple (std::size_t t0, std::size_t t1, std::size_t t2, std::size_t & tuple) const
+{
+	std::size_t key[3] = {t0, t1, t2};
+	std::size_t low = 0;
+	std::size_t high = _num_tuples;
+	while (low < high)
+	{
+		std::size_t mid = low + (high - low) / 2;
+		int cmp = 0;
+		for (int i = 0; i < 3 && cmp == 0; ++i)
+		{
+			std::size_t token = GetToken (mid, i);
+			if (token < key[i]) cmp = -1;
+			else if (token > key[i]) cmp = 1;
+		}
+		if (cmp == 0)
+		{
+			tuple = mid;
+			return true;
+		}
+		else if (cmp < 0)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return false;
+}
+
+bool MappedIndex::IsTemplateTuple (std::size_t tuple) const
+{
+	assert (tuple < _num_tuples);
+	return (_tuple_flags[tuple] & 1) != 0;
+}
+
+int MappedIndex::GetDocumentCount (std::size_t tuple) const
+{
+	assert (tuple < _num_tuples);
+	return wxUINT64_SWAP_ON_BE (_tuple_postings[tuple+1]) - wxUINT64_SWAP_ON_BE (_tuple_postings[tuple]);
+}
+
+int MappedIndex::GetDocument (std::size_t tuple, int i) const
+{
+	assert (i >= 0 && i < GetDocumentCount (tuple));
+	return wxUINT32_SWAP_ON_BE (_document_ids[wxUINT64_SWAP_ON_BE (_tuple_postings[tuple]) + i]);
+}
+
+void MappedIndex::GetDocuments (std::size_t tuple, std::vector<int> & docs) const
+{
+	docs.clear ();
+	for (int i = 0, n = GetDocumentCount (tuple); i < n; ++i)
+	{
+		docs.push_back (GetDocument (tuple, i));
+	}
+}
+
+wxUint32 MappedIndex::ReadUInt32 (wxFileOffset position) const
+{
+	wxUint32 n = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		n |= ((wxUint32)_data[position + i]) << (8 * i);
+	}
+	return n;
+}
+
+wxUint64 MappedIndex::ReadUInt64 (wxFileOffset position) const
+{
+	return ((wxUint64)ReadUInt32 (position + 4) << 32) | ReadUInt32 (position);
+}
@@ -0,0 +1,78 @@
+#if !defined mappedindex_h
+#define mappedindex_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <assert.h>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/file.h>
+
+class TokenSet;
+class TupleSet;
+
+/** MappedIndex is a read-only index of tokens and trigrams, held in a file
+  * which is mapped into memory and queried in place, so opening it does not
+  * depend on its size, and processes using the same index share its pages.
+  * -- a TokenSet and TupleSet can use a MappedIndex as a base, adding any
+  *    new tokens and trigrams in memory (see TokenSet::SetBase, TupleSet::SetBase)
+  *
+  * The file holds a fixed header, followed by arrays aligned to 8 bytes:
+  *   token offsets   -- (num_tokens+1) x u64, start of each token's UTF-8 bytes
+  *   token order     -- num_tokens x u32, token ids sorted by their bytes
+  *   token strings   -- the UTF-8 bytes of every token
+  *   tuple keys      -- num_tuples x 3 x u32, token ids of each trigram, sorted
+  *   tuple postings  -- (num_tuples+1) x u64, start of each trigram's documents
+  *   document ids    -- u32 for each (trigram, document), sorted within trigram
+  *   tuple flags     -- num_tuples x u8, bit 0 set for template material
+  * and then a section, in the BinaryWriter format, defining the documents,
+  * written by DocumentList::SaveIndex.
+  * Numbers are little-endian.  Where memory mapping is not available, the
+  * file is read into memory when opened.
+  */
+class MappedIndex
+{
+	public:
+		MappedIndex ();
+		~MappedIndex ();
+		bool Open (wxString path);
+		void Close ();
+		bool IsOpen () const;
+		// writes index of tokens and tuples, leaving file at position for documents
+		static bool Write (wxFile & file, TokenSet & tokenset, TupleSet & tupleset);
+		wxFileOffset GetDocumentsPosition () const;
+		// tokens
+		std::size_t GetTokenCount () const;
+		wxString GetTokenString (std::size_t token) const;
+		bool FindToken (const wxString & token, std::size_t & index) const;
+		// tuples, held in sorted order
+		std::size_t GetTupleCount () const;
+		std::size_t GetToken (std::size_t tuple, int i) const;
+		bool FindTuple (std::size_t t0, std::size_t t1, std::size_t t2, std::size_t & tuple) const;
+		bool IsTemplateTuple (std::size_t tuple) const;
+		int GetDocumentCount (std::size_t tuple) const;
+		int GetDocument (std::size_t tuple, int i) const;
+		void GetDocuments (std::size_t tuple, std::vector<int> & docs) const;
+	private:
+		MappedIndex (const MappedIndex &);             // -- not copyable
+		MappedIndex & operator= (const MappedIndex &);
+		wxUint32 ReadUInt32 (wxFileOffset position) const;
+		wxUint64 ReadUInt64 (wxFileOffset position) const;
+		int CompareToken (wxUint32 token, const char * bytes, size_t length) const;
+		const wxUint8 * _data;
+		wxFileOffset _length;
+		bool _is_mapped;  // -- true if _data is mapped, false if read into memory
+		std::size_t _num_tokens;
+		std::size_t _num_tuples;
+		const wxUint64 * _token_offsets;
+		const wxUint32 * _token_order;
+		const char * _token_strings;
+		const wxUint32 * _tuple_keys;
+		const wxUint64 * _tuple_postings;
+		const wxUint32 * _document_ids;
+		const wxUint8 * _tuple_flags;
+		wxFileOffset _documents_position;
+};
+
+#endif
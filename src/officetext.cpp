@@ -0,0 +1,139 @@
+#include "officetext.h"
+
+// test the file's extension, ignoring case
+bool OfficeText::IsOfficeFile (wxString path)
+{
+	return !GetContentName (path).IsEmpty ();
+}
+
+// name of the archive entry holding the document's text
+wxString OfficeText::GetContentName (wxString path)
+{
+	wxString extension = path.AfterLast ('.');
+	if (extension.IsSameAs ("docx", false)) return "word/document.xml";
+	if (extension.IsSameAs ("odt", false)) return "content.xml";
+	return "";
+}
+
+// move zip to the start of the named entry
+bool OfficeText::OpenContent (wxZipInputStream & zip, wxString name)
+{
+	wxZipEntry * entry;
+	while ((entry = zip.GetNextEntry ()) != NULL)
+	{
+		bool found = (entry->GetName (wxPATH_UNIX) == name);
+		delete entry;
+		if (found) return true;
+	}
+	return false;
+}
+
+bool OfficeText::HasText (wxString path)
+{
+	wxString name = GetContentName (path);
+	if (name.IsEmpty ()) return false;
+	wxFFileInputStream input (path);
+	if (!input.IsOk ()) return false;
+	wxZipInputStream zip (input);
+	return OpenContent (zip, name);
+}
+
+// -- the XML is parsed straight from the archive, without unpacking it
+bool OfficeText::ReadText (wxString path, wxString & text)
+{
+	text = "";
+	wxString name = GetContentName (path);
+	if (name.IsEmpty ()) return false;
+	wxFFileInputStream input (path);
+	if (!input.IsOk ()) return false;
+	wxZipInputStream zip (input);
+	if (!OpenContent (zip, name)) return false;
+
+	// -- whitespace between runs of text can be significant
+	wxXmlDocument document;
+	if (!document.Load (zip, "UTF-8", wxXMLDOC_KEEP_WHITESPACE_NODES)) return false;
+	if (name == "content.xml")
+	{
+		AppendOpenDocumentText (document.GetRoot (), text, false);
+	}
+	else
+	{
+		AppendWordText (document.GetRoot (), text);
+	}
+	return true;
+}
+
+// name of element without its namespace prefix, e.g. "w:p" gives "p"
+wxString OfficeText::GetLocalName (wxXmlNode * node)
+{
+	return node->GetName().AfterLast (':');
+}
+
+// Word keeps text in <w:t> elements, within runs <w:r> of paragraphs <w:p>
+// -- deleted text is held in <w:delText>, and so is left out
+void OfficeText::AppendWordText (wxXmlNode * node, wxString & text)
+{
+	for (wxXmlNode * child = node->GetChildren (); child != NULL; child = child->GetNext ())
+	{
+		if (child->GetType () != wxXML_ELEMENT_NODE) continue;
+		wxString name = GetLocalName (child);
+		if (name == "t")
+		{
+			text += child->GetNodeContent ();
+		}
+		else if (name == "tab")
+		{
+			text += "\t";
+		}
+		else if (name == "br" || name == "cr")
+		{
+			text += "\n";
+		}
+		else
+		{
+			AppendWordText (child, text);
+			if (name == "p") text += "\n";
+		}
+	}
+}
+
+// OpenDocument keeps text directly within <text:p> and <text:h> elements,
+// with spans, links etc inside them
+// -- runs of spaces are given by <text:s text:c="n"/>
+void OfficeText::AppendOpenDocumentText (wxXmlNode * node, wxString & text, bool in_paragraph)
+{
+	for (wxXmlNode * child = node->GetChildren (); child != NULL; child = child->GetNext ())
+	{
+		if (child->GetType () == wxXML_TEXT_NODE || child->GetType () == wxXML_CDATA_SECTION_NODE)
+		{
+			if (in_paragraph) text += child->GetContent ();
+			continue;
+		}
+		if (child->GetType () != wxXML_ELEMENT_NODE) continue;
+		wxString name = GetLocalName (child);
+		if (name == "s")
+		{
+			long count = 1;
+			child->GetAttribute ("text:c", "1").ToLong (&count);
+			text += wxString (' ', count < 1 ? 1 : count);
+		}
+		else if (name == "tab")
+		{
+			text += "\t";
+		}
+		else if (name == "line-break")
+		{
+			text += "\n";
+		}
+		else if (name == "p" || name == "h")
+		{
+			AppendOpenDocumentText (child, text, true);
+			text += "\n";
+		}
+		else if (name != "annotation" && name != "note-citation")
+		{
+			AppendOpenDocumentText (child, text, in_paragraph);
+		}
+	}
+}
+
@@ -0,0 +1,37 @@
+#if !defined officetext_h
+#define officetext_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <wx/wx.h>
+#include <wx/wfstream.h>
+#include <wx/xml/xml.h>
+#include <wx/zipstrm.h>
+
+/** OfficeText reads the text of word-processor documents held as zipped XML,
+  * i.e. Word (.docx) and OpenDocument (.odt) files, without calling out to a
+  * converter.
+  * -- the document's XML part (word/document.xml or content.xml) is read 
+  *    straight from the archive, and its text collected, with each 
+  *    paragraph on its own line
+  * -- other word-processor formats (.doc, .rtf, .abw) are left to abiword
+  */
+class OfficeText
+{
+	public:
+		static bool IsOfficeFile (wxString path);
+		// true if the archive holds the document's XML part
+		static bool HasText (wxString path);
+		// read the text of the document, returning false if it cannot be read
+		static bool ReadText (wxString path, wxString & text);
+	private:
+		static wxString GetContentName (wxString path);
+		static bool OpenContent (wxZipInputStream & zip, wxString name);
+		static void AppendWordText (wxXmlNode * node, wxString & text);
+		static void AppendOpenDocumentText (wxXmlNode * node, wxString & text, bool in_paragraph);
+		static wxString GetLocalName (wxXmlNode * node);
+};
+
+#endif
+
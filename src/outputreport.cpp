@@ -13,12 +13,52 @@ void OutputReport::StartCopiedBlock (bool is_unique, bool is_template) {}
 void OutputReport::StartNormalBlock () {}
 void OutputReport::WriteString (wxString str) {}
 
+// Find which trigrams of document doc1 match doc2, as a first pass before writing
+// -- when winnowing, only fingerprints are indexed, but any run of text shared by the 
+//    documents has a matching fingerprint in every window, so the trigrams between 
+//    matching trigrams at most a window apart are taken to match too
+void OutputReport::FindMatches (int doc1, int doc2, std::vector<TrigramMatch> & trigrams)
+{
+	Document * document1 = _doclist[doc1];
+	TokenSet & tokenset = _doclist.GetTokenSet ();
+	int last_match = -1;
+	int window = _doclist.GetWinnowing ();
+	while (document1->ReadTrigram (tokenset))
+	{
+		TrigramMatch trigram;
+		for (int k = 0; k < 3; ++k) trigram.tokens[k] = document1->GetToken (k);
+		trigram.start = document1->GetTrigramStart ();
+		trigram.end = document1->GetTrigramEnd ();
+		trigram.next_start = document1->GetTrigramStart (1);
+		trigram.is_unique = _doclist.IsMatchingTrigram (
+				trigram.tokens[0], trigram.tokens[1], trigram.tokens[2], doc1, doc2, true, false);
+		trigram.is_template = _doclist.IsTemplateTrigram (
+				trigram.tokens[0], trigram.tokens[1], trigram.tokens[2]);
+		// -- flag _unique used to restrict display to unique matches
+		trigram.is_match = _doclist.IsMatchingTrigram (
+				trigram.tokens[0], trigram.tokens[1], trigram.tokens[2], doc1, doc2, _unique, _ignore);
+		trigrams.push_back (trigram);
+
+		int current = trigrams.size () - 1;
+		if (!trigram.is_match) continue;
+		if (window > 0 && last_match >= 0 && current - last_match <= window)
+		{
+			for (int i = last_match + 1; i < current; ++i)
+			{
+				trigrams[i].is_match = true;
+				trigrams[i].is_unique = trigrams[last_match].is_unique;
+				trigrams[i].is_template = trigrams[last_match].is_template;
+			}
+		}
+		last_match = current;
+	}
+}
+
 void OutputReport::WriteDocument (int doc1, int doc2)
 {
 	// -- write internal text from document
-	wxFFile f (_doclist[doc1]->GetPathname (), "rb");
   wxString txt;
-  f.ReadAll (&txt);
+	_doclist[doc1]->ReadText (txt);
 	txt.Replace ("\t", "    "); // replace tabs with 4-spaces, to ensure they show up in all outputs
 
 	// make an input stream for the read document
@@ -27,6 +67,10 @@ void OutputReport::WriteDocument (int doc1, int doc2)
 
 	Document * document1 = _doclist[doc1];
 	document1->StartInput (in, tokenset); // make document read from string of document
+	std::vector<TrigramMatch> trigrams;
+	FindMatches (doc1, doc2, trigrams);
+	document1->CloseInput ();
+
 	int lastwritten = 0;
 	bool insideblock = false;
   bool insidespecialblock = false;
@@ -36,43 +80,23 @@ void OutputReport::WriteDocument (int doc1, int doc2)
   bool was_template = false;
   bool is_template = false;
 
-	while (document1->ReadTrigram (tokenset))
+	for (int t = 0, n = trigrams.size (); t < n; ++t)
   { 
+    const TrigramMatch & trigram = trigrams[t];
     was_unique = is_unique;
-    is_unique = _doclist.IsMatchingTrigram (
-        document1->GetToken (0),
-        document1->GetToken (1),
-        document1->GetToken (2),
-        doc1,
-        doc2,
-        true,
-        false
-        );
+    is_unique = trigram.is_unique;
     was_template = is_template;
-    is_template = _doclist.IsTemplateTrigram (
-        document1->GetToken (0),
-        document1->GetToken (1),
-        document1->GetToken (2)
-        );
+    is_template = trigram.is_template;
 
     // test if trigram is a match across the documents
-    // -- flag _unique used to restrict display to unique matches
-    if (_doclist.IsMatchingTrigram (
-          document1->GetToken (0),
-          document1->GetToken (1),
-          document1->GetToken (2),
-          doc1,
-          doc2,
-          _unique,
-          _ignore
-          ))
+    if (trigram.is_match)
     { // processing a matching trigram
       if (!insideblock)
       {
         if (lastwritten > 0) EndBlock ();
         // write any unwritten text up to start of this block
-        WriteString (txt.Mid (lastwritten, document1->GetTrigramStart()-lastwritten));
-        lastwritten = document1->GetTrigramStart ();
+        WriteString (txt.Mid (lastwritten, trigram.start-lastwritten));
+        lastwritten = trigram.start;
         // start style depends on uniqueness/template of trigram 
         StartCopiedBlock (is_unique, is_template); 
         insideblock = true;
@@ -97,15 +121,15 @@ void OutputReport::WriteDocument (int doc1, int doc2)
         }
       }
       // write the trigram
-      WriteString (txt.Mid (lastwritten, document1->GetTrigramEnd()-lastwritten));
-      lastwritten = document1->GetTrigramEnd ();
+      WriteString (txt.Mid (lastwritten, trigram.end-lastwritten));
+      lastwritten = trigram.end;
       ProcessTrigram (
           _doclist.MakeTrigramString(
-            document1->GetToken (0),
-            document1->GetToken (1),
-            document1->GetToken (2)),
-          document1->GetTrigramStart (),
-          document1->GetTrigramEnd ()
+            trigram.tokens[0],
+            trigram.tokens[1],
+            trigram.tokens[2]),
+          trigram.start,
+          trigram.end
           );
     }
     else // inside a block already
@@ -127,7 +151,7 @@ void OutputReport::WriteDocument (int doc1, int doc2)
         StartCopiedBlock (is_unique, is_template);
       }
 
-      if (lastwritten < document1->GetTrigramStart (1))
+      if (lastwritten < trigram.next_start)
       {
         if (insideblock || insidespecialblock || (lastwritten == 0)) // moving from inside block to not
         {
@@ -136,8 +160,8 @@ void OutputReport::WriteDocument (int doc1, int doc2)
           insidespecialblock = false;
           StartNormalBlock ();
         }
-        WriteString (txt.Mid (lastwritten, document1->GetTrigramStart(1)-lastwritten));
-        lastwritten = document1->GetTrigramStart (1);
+        WriteString (txt.Mid (lastwritten, trigram.next_start-lastwritten));
+        lastwritten = trigram.next_start;
       }
     }
   }
@@ -154,6 +178,5 @@ void OutputReport::WriteDocument (int doc1, int doc2)
 	}
 	EndBlock ();
 	WriteDocumentFooter ();
-	document1->CloseInput ();
 }
 
@@ -1,6 +1,7 @@
 #if !defined outputreport_h
 #define outputreport_h
 
+#include <vector>
 #include <wx/wx.h>
 #include <wx/sstream.h>
 
@@ -10,6 +11,8 @@
 /** This class provides a 'visitor' pattern, for different kinds of document display.
  *  Child classes should implement the virtual methods, 
  *  so that WriteDocument can be used to walk through a document, highlighting common parts.
+ *  -- the matching trigrams are found first, so a trigram can be shown as matching 
+ *     because of those around it, e.g. between fingerprints when winnowing
  */
 
 class OutputReport
@@ -24,6 +27,17 @@ class OutputReport
 		virtual void WriteString (wxString str);
 		void WriteDocument (int doc1, int doc2);
 	protected:
+		struct TrigramMatch
+		{
+			std::size_t tokens[3];
+			int start;
+			int end;
+			int next_start; // -- start of the trigram's second token
+			bool is_match;
+			bool is_unique;
+			bool is_template;
+		};
+		void FindMatches (int doc1, int doc2, std::vector<TrigramMatch> & trigrams);
 		DocumentList & _doclist;
     bool           _unique;
     bool           _ignore;
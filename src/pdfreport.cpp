@@ -154,8 +154,8 @@ void PdfReport::WritePdfReport (wxString save_report_path, int document1, int do
 	// initial summary
 	_pdf.SetFont (_T("Arial"), _T("B"), 14);
 	PrintLine (wxString::Format ("Comparing '%s' with '%s'",
-				_doclist[document1]->GetName().c_str(), 
-				_doclist[document2]->GetName().c_str()), 
+				_doclist.GetName (document1).c_str(), 
+				_doclist.GetName (document2).c_str()), 
 			wxPDF_ALIGN_CENTER);
 	_pdf.SetFont (_T("Arial"), _T(""), 11);
 	PrintLine (wxString::Format ("Document 1 source: %s",
@@ -205,7 +205,7 @@ void PdfReport::PrintDocument (int num, int doc1, int doc2)
     /*
 	_pdf.AddPage ();
 	_pdf.SetFont (_T("Times"), _T(""), 12); // set font to Times 12pt
-	DocumentTitle (num, _doclist[doc1]->GetName ());
+	DocumentTitle (num, _doclist.GetName (doc1));
 	WriteDocument (doc1, doc2);
 	*/
 }
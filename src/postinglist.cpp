@@ -0,0 +1,110 @@
+#include "postinglist.h"
+
+PostingList::PostingList ()
+	: _header (0),
+	  _capacity (0)
+{}
+
+PostingList::PostingList (const PostingList & other)
+	: _header (0),
+	  _capacity (0)
+{
+	*this = other;
+}
+
+// -- a list on the heap is copied to a new array, just large enough
+PostingList & PostingList::operator= (const PostingList & other)
+{
+	if (this == &other) return *this;
+	if (!IsInline ()) delete[] _heap;
+	_header = other._header;
+	_capacity = 0;
+	if (IsInline ())
+	{
+		std::copy (other._inline, other._inline + INLINE_SIZE, _inline);
+	}
+	else
+	{
+		_capacity = GetCount ();
+		_heap = new int [_capacity];
+		std::copy (other._heap, other._heap + GetCount (), _heap);
+	}
+	return *this;
+}
+
+PostingList::~PostingList ()
+{
+	if (!IsInline ()) delete[] _heap;
+}
+
+int PostingList::GetCount () const
+{
+	return _header >> 1;
+}
+
+int PostingList::GetDocument (int i) const
+{
+	assert (i >= 0 && i < GetCount ());
+	return GetDocuments ()[i];
+}
+
+const int * PostingList::GetDocuments () const
+{
+	return (IsInline () ? _inline : _heap);
+}
+
+bool PostingList::HasDocument (int document) const
+{
+	const int * documents = GetDocuments ();
+	return std::find (documents, documents + GetCount (), document) != documents + GetCount ();
+}
+
+// -- moves to the heap when the list outgrows the inline space,
+//    and doubles the heap array when full
+void PostingList::AddDocument (int document)
+{
+	int count = GetCount ();
+	if (count == INLINE_SIZE)
+	{
+		int * heap = new int [2 * INLINE_SIZE];
+		std::copy (_inline, _inline + INLINE_SIZE, heap);
+		_heap = heap;
+		_capacity = 2 * INLINE_SIZE;
+	}
+	else if (count > INLINE_SIZE && (wxUint32)count == _capacity)
+	{
+		int * heap = new int [2 * _capacity];
+		std::copy (_heap, _heap + count, heap);
+		delete[] _heap;
+		_heap = heap;
+		_capacity *= 2;
+	}
+	_header += 2;
+	GetStorage ()[count] = document;
+}
+
+void PostingList::Sort ()
+{
+	std::sort (GetStorage (), GetStorage () + GetCount ());
+}
+
+bool PostingList::IsTemplate () const
+{
+	return (_header & 1) != 0;
+}
+
+void PostingList::SetTemplate ()
+{
+	_header |= 1;
+}
+
+bool PostingList::IsInline () const
+{
+	return GetCount () <= INLINE_SIZE;
+}
+
+int * PostingList::GetStorage ()
+{
+	return (IsInline () ? _inline : _heap);
+}
+
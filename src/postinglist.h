@@ -0,0 +1,49 @@
+#if !defined postinglist_h
+#define postinglist_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <assert.h>
+#include <algorithm>
+#include <wx/wx.h>
+
+/** PostingList holds the documents of one tuple, and whether the tuple is in
+  * template material, for the maps of a TupleSet.
+  * -- most tuples are in one document, and most others in two, so up to two
+  *    documents are held in the list itself, and only longer lists are held
+  *    on the heap: a list takes 16 bytes, with no allocation for short lists
+  * -- the template flag is kept in the lowest bit of the count of documents
+  * -- documents are kept in the order added, and the list may hold a
+  *    document more than once: TupleSet checks with HasDocument
+  */
+class PostingList
+{
+	public:
+		PostingList ();
+		PostingList (const PostingList & other);
+		PostingList & operator= (const PostingList & other);
+		~PostingList ();
+		int GetCount () const;
+		int GetDocument (int i) const;
+		const int * GetDocuments () const; // -- GetCount () documents, in order
+		bool HasDocument (int document) const;
+		void AddDocument (int document);
+		void Sort ();
+		bool IsTemplate () const;
+		void SetTemplate ();
+	private:
+		enum { INLINE_SIZE = 2 };
+		bool IsInline () const;
+		int * GetStorage ();
+		union
+		{
+			int	_inline[INLINE_SIZE]; // -- the documents, while no more than INLINE_SIZE
+			int *	_heap;               // -- the documents, once there are more
+		};
+		wxUint32	_header;   // -- number of documents, times two, plus one for template material
+		wxUint32	_capacity; // -- of _heap, once used
+};
+
+#endif
+
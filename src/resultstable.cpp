@@ -56,7 +56,7 @@ void DocumentListCtrl::UpdatedDocumentList ()
 	for (int i=0; i<num_docs; ++i)
 		for (int j=i+1; j<num_docs; ++j)
 		{
-			if (doclist[i]->GetGroupId () != doclist[j]->GetGroupId ())
+			if (doclist.GetGroupId (i) != doclist.GetGroupId (j))
 			{ // only add pair if not in same group
 				_document1.push_back (i);
 				_document2.push_back (j);
@@ -217,18 +217,11 @@ void DocumentListCtrl::SortOnResemblance (bool force_sort)
 	_ferretparent->SetStatusText ("Rearranged table by similarity", 0);
 }
 
+// mean is read from the statistics kept by the document list
 float DocumentListCtrl::MeanResemblance () const
 {
-  float total = 0.0;
-  for (int i=0, n=_ferretparent->GetDocumentList().Size (); i<n; i++)
-  {
-    for (int j=i+1, m=_ferretparent->GetDocumentList().Size (); j < m; j++)
-    {
-      total += _ferretparent->GetDocumentList().ComputeResemblance (i, j, _remove_common_trigrams, _ignore_template_material);
-    }
-  }
-
-  return total / _ferretparent->GetDocumentList().NumberOfPairs ();
+  return _ferretparent->GetDocumentList().GetStatistics ()
+    .GetSummary (_remove_common_trigrams, _ignore_template_material).GetMean ();
 }
 
 wxString DocumentListCtrl::OnGetItemText (long item, long column) const
@@ -385,7 +378,7 @@ wxString DocumentListCtrl::GetPathname (int i) const
 // Return the file name for given document, by retrieving item from parent document list
 wxString DocumentListCtrl::GetName (int i) const
 {
-	return _ferretparent->GetDocumentList()[i]->GetName ();
+	return _ferretparent->GetDocumentList().GetName (i);
 }
 
 // Return the file or pathname for given document
@@ -394,13 +387,13 @@ wxString DocumentListCtrl::GetDisplayName (int i) const
 {
   wxString result = "";
   // add an indicator for template code
-  if (_ferretparent->GetDocumentList()[i]->GetGroupId () == 0)
+  if (_ferretparent->GetDocumentList().GetGroupId (i) == 0)
   {
     result = "TM:";
   }
   if (_show_short)
   {
-    result += _ferretparent->GetDocumentList()[i]->GetShortName ();
+    result += _ferretparent->GetDocumentList().GetShortName (i);
   }
   else
   {
@@ -507,7 +500,7 @@ void ComparisonTableView::OnSaveReport (wxCommandEvent & WXUNUSED(event))
 	if (dialog.ShowModal () == wxID_OK)
 	{
 		wxString path = dialog.GetPath ();
-		SaveTableThread * thread = new SaveTableThread (path, _documentlist, *_resemblanceObserver);
+		SaveTableThread * thread = new SaveTableThread (path, * _documentlist, *_resemblanceObserver);
 		if (thread->Create () == wxTHREAD_NO_ERROR)
 		{
 			thread->Run ();
@@ -528,7 +521,7 @@ void ComparisonTableView::OnShowUniqueView (wxCommandEvent & WXUNUSED(event))
 {
  	wxBusyCursor wait;
 	wxGetApp().Yield ();
-	UniqueTrigramsView * view = new UniqueTrigramsView (this, _documentlist);
+	UniqueTrigramsView * view = new UniqueTrigramsView (this, * _documentlist);
 	view->Show (true);
 }
 
@@ -536,7 +529,7 @@ void ComparisonTableView::OnShowEngagementView (wxCommandEvent & WXUNUSED(event)
 {
  	wxBusyCursor wait;
 	wxGetApp().Yield ();
-	EngagementTrigramsView * view = new EngagementTrigramsView (this, _documentlist);
+	EngagementTrigramsView * view = new EngagementTrigramsView (this, * _documentlist);
 	view->Show (true);
 }
 
@@ -579,7 +572,8 @@ void ComparisonTableView::OnResize (wxSizeEvent & event)
 
 ComparisonTableView::ComparisonTableView()
 	: wxFrame(NULL, wxID_ANY, "Ferret: Table of comparisons", 
-		wxDefaultPosition, wxSize (650, 610))
+		wxDefaultPosition, wxSize (650, 610)),
+	  _documentlist (NULL)
 {
 	CentreOnScreen ();
 	CreateStatusBar(4);
@@ -685,18 +679,26 @@ void ComparisonTableView::OnClose (wxCloseEvent & WXUNUSED(event))
 	Destroy ();
 }
 
-void ComparisonTableView::SetDocumentList (DocumentList & documentlist)
+ComparisonTableView::~ComparisonTableView ()
+{
+	delete _documentlist;
+}
+
+// The view takes over the given document list, which must have been created on 
+// the heap, and deletes it when the view is destroyed
+void ComparisonTableView::SetDocumentList (DocumentList * documentlist)
 {
+	delete _documentlist;
 	_documentlist = documentlist;
-	SetStatusText (wxString::Format ("Documents: %d", _documentlist.Size()), 1);
-	SetStatusText (wxString::Format ("Pairs: %d", _documentlist.NumberOfPairs()), 2);
-	_documentlist.ComputeSimilarities ();
+	SetStatusText (wxString::Format ("Documents: %d", _documentlist->Size()), 1);
+	SetStatusText (wxString::Format ("Pairs: %d", _documentlist->NumberOfPairs()), 2);
+	_documentlist->ComputeSimilarities ();
  	_resemblanceObserver->UpdatedDocumentList ();
 	_resemblanceObserver->SortOnResemblance ();
 	_resemblanceObserver->SelectFirstItem ();
   SetStatusText (wxString::Format ("Mean: %f", _resemblanceObserver->MeanResemblance()), 3);
-  ((wxButton *) FindWindow (ID_ENGAGEMENT_VIEW))->Enable (_documentlist.HasTemplateMaterial ());
-  ((wxCheckBox *) FindWindow (ID_IGNORE_TEMPLATE))->Enable (_documentlist.HasTemplateMaterial ());
+  ((wxButton *) FindWindow (ID_ENGAGEMENT_VIEW))->Enable (_documentlist->HasTemplateMaterial ());
+  ((wxCheckBox *) FindWindow (ID_IGNORE_TEMPLATE))->Enable (_documentlist->HasTemplateMaterial ());
 }
 
 
@@ -120,6 +120,7 @@ class ComparisonTableView: public wxFrame
 {
 	public:
     ComparisonTableView ();
+    ~ComparisonTableView ();
 		void OnRank1   	   (wxCommandEvent & event);
 		void OnRank2   	   (wxCommandEvent & event);
 		void OnRank3   	   (wxCommandEvent & event);
@@ -135,18 +136,18 @@ class ComparisonTableView: public wxFrame
     void UpdateSimilarity ();
     void OnCheckShortNames (wxCommandEvent & event);
 		void OnClose (wxCloseEvent & event);
-		void SetDocumentList (DocumentList & documentlist);
+		void SetDocumentList (DocumentList * documentlist); // takes ownership of documentlist
 		void SaveReportFor (int document1, int document2, bool unique, bool ignore);
 		wxString GetName (int document) const;
 		DocumentList & GetDocumentList ()
 		{ 
-			return _documentlist;
+			return * _documentlist;
 		}
 	private:
 		void OnResize (wxSizeEvent & event);
 		void CalculateMeasures ();
 		DECLARE_EVENT_TABLE()
-		DocumentList 	 _documentlist;
+		DocumentList 	 * _documentlist; // -- owned by this view
 		DocumentListCtrl * _resemblanceObserver;
 };
 
@@ -16,18 +16,29 @@ void MyListCtrl::AddPath (wxString path)
 // count all files within any directories,
 // but treat directories as single entities, if their files are grouped
 // i.e. we want 2 or more directories to compare
+// -- directories are counted with a DirectoryWalker, as DocumentList adds them,
+//    so ignored folders, and files of unknown type if these are ignored, are not counted
 int MyListCtrl::GetAllFileCount (bool grouped) const
 {
   int count = 0;
+  DirectoryWalker walker;
+  walker.SetIgnoreUnknown (wxGetApp().GetIgnoreUnknown ());
 
   for (int i = 0, n = _paths.GetCount (); i < n; i += 1)
   {
     if (!grouped && wxFileName::DirExists (_paths[i]))
     {
       wxArrayString files;
-      wxDir::GetAllFiles (_paths[i], &files, wxEmptyString);
+      wxArrayString ignored;
+      walker.Walk (_paths[i], files, ignored);
       count += files.GetCount ();
     }
+    else if (!grouped && ArchiveReader::IsArchive (_paths[i]))
+    {
+      wxArrayString members;
+      ArchiveReader::ListMembers (_paths[i], members);
+      count += members.GetCount ();
+    }
     else
     {
       count += 1;
@@ -141,8 +152,8 @@ SelectFiles::SelectFiles ()
 	button_sizer->Add (MakeButton (this, ID_SETTINGS, "Settings ...",
 				"Advanced users: Control how Ferret converts your files"), 
 			0, wxGROW | wxLEFT | wxRIGHT, 5);
-  button_sizer->Add (MakeCheckBox (this, ID_GROUP_DIRS, "Group files in directories",
-        "Do not compare files in directories with each other"),
+  button_sizer->Add (MakeCheckBox (this, ID_GROUP_DIRS, "Group files in directories or archives",
+        "Do not compare files in the same directory or archive with each other"),
       0, wxGROW | wxLEFT | wxRIGHT, 5);
 	button_sizer->AddStretchSpacer (1);
 	button_sizer->Add (MakeButton (this, ID_RUN_FERRET, "Run Ferret",
@@ -177,7 +188,7 @@ void SelectFiles::OnAdd (wxCommandEvent & WXUNUSED(event))
 {
 	wxFileDialog dialog (NULL, "Select file(s) to compare", 
 			wxEmptyString, wxEmptyString,
-			"All Files|*|Text (*.txt)|*.txt|Word (*.doc, *.docx)|*.doc;*.docx|Rich Text Format (*.rtf)|*.rtf|pdf (*.pdf)|*.pdf|C++ (*.cpp, *.h)|*.cpp;*.h|C (*.c, *.h)|*.c;*.h|C# (*.cs)|*.cs|Clojure (*.clj)|*.clj|Groovy (*.groovy)|*.groovy|Haskell (*.hs, *.lhs)|*.hs;*.lhs|Java (*.java)|*.java|Lisp (*.lisp,*.lsp)|*.lisp;*.lsp|Prolog (*.pl)|*.pl|Python (*.py)|*.py|Racket (*.rkt)|*.rkt|Ruby (*.rb)|*.rb|Scheme (*.ss, *.scm)|*.scm;*.ss|Visual Basic (*.vb)|*.vb|Xml/Html (*.xml, *.html)|*.xml;*.html",
+			"All Files|*|Text (*.txt)|*.txt|Word (*.doc, *.docx)|*.doc;*.docx|OpenDocument (*.odt)|*.odt|Archives (*.zip, *.tar, *.tar.gz, *.tgz)|*.zip;*.tar;*.tar.gz;*.tgz|Rich Text Format (*.rtf)|*.rtf|pdf (*.pdf)|*.pdf|C++ (*.cpp, *.h)|*.cpp;*.h|C (*.c, *.h)|*.c;*.h|C# (*.cs)|*.cs|Clojure (*.clj)|*.clj|Groovy (*.groovy)|*.groovy|Haskell (*.hs, *.lhs)|*.hs;*.lhs|Java (*.java)|*.java|Lisp (*.lisp,*.lsp)|*.lisp;*.lsp|Prolog (*.pl)|*.pl|Python (*.py)|*.py|Racket (*.rkt)|*.rkt|Ruby (*.rb)|*.rb|Scheme (*.ss, *.scm)|*.scm;*.ss|Visual Basic (*.vb)|*.vb|Xml/Html (*.xml, *.html)|*.xml;*.html",
 			wxFD_OPEN | wxFD_CHANGE_DIR | wxFD_MULTIPLE | wxFD_FILE_MUST_EXIST );
 	if (dialog.ShowModal () == wxID_OK)
 	{
@@ -205,6 +216,7 @@ void SelectFiles::OnCheckGroup (wxCommandEvent & WXUNUSED(event))
 }
 
 // return true if there are only directories in file list, and at least one directory
+// -- zip/tar archives are grouped in the same way as directories
 bool SelectFiles::ContainsOnlyDirectories ()
 {
   MyListCtrl * file_list = (MyListCtrl *) FindWindow (ID_FILE_LIST);
@@ -212,7 +224,8 @@ bool SelectFiles::ContainsOnlyDirectories ()
   
   for (int i = 0; i < file_list->GetCount (); i += 1)
   {
-    if (!wxFileName::DirExists (file_list->GetItem (i)))
+    if (!wxFileName::DirExists (file_list->GetItem (i)) &&
+        !ArchiveReader::IsArchive (file_list->GetItem (i)))
     {
       result = false;
     }
@@ -237,6 +250,12 @@ void SelectFiles::UpdateButtons ()
   grouped->Enable (ContainsOnlyDirectories ());
 }
 
+// document list is only deleted here if it was not passed to a comparison view
+SelectFiles::~SelectFiles ()
+{
+	delete _document_list;
+}
+
 void SelectFiles::OnClear (wxCommandEvent & WXUNUSED(event))
 {
 	((MyListCtrl *) FindWindow (ID_FILE_LIST))->ClearPaths ();
@@ -369,7 +388,8 @@ void SelectFiles::CreateComparisonView ()
 	{
 		wxBusyCursor wait;
 		wxBusyInfo info ("Please wait: computing similarities ...", this);
-		frame->SetDocumentList (*_document_list);
+		frame->SetDocumentList (_document_list); // frame now owns the document list
+		_document_list = NULL;
 	}
 	// tidy up, and show the Ferret table of comparisons
 	this->Destroy (); // don't close, as not exiting application
@@ -395,6 +415,7 @@ void SelectFiles::ReadDocuments (int start_from)
 #endif
 	dialog.CentreOnParent ();
 
+	_document_list->FindDuplicates (start_from); // -- so copies of files are read once
 	for (int i = start_from, n = _document_list->Size (); i < n; ++i)
 	{
 		if (!dialog.Update (i - start_from))
@@ -433,14 +454,44 @@ bool SelectFiles::ExtractFiles (int start_from)
 	std::vector<Document *> to_remove; // keep a list of documents to remove
 	// work through the documents in document list, performing copy/extraction where
 	// appropriate
+	// -- converters are run in a pool, and each document is finished as its 
+	//    converter completes
+	ConversionPool pool (wxGetApp().GetConversionProcesses (), wxGetApp().GetConversionTimeout ());
+	int num_done = 0;
 	for (int i = start_from, n = _document_list->Size (); i < n; ++i)
 	{
-		if (!dialog.Update (i - start_from, "Please wait, processing file ..."))
+		wxArrayString command;
+		if (!(*_document_list)[i]->StartExtraction (extract_folder, i, command))
+		{
+			to_remove.push_back ((*_document_list)[i]);
+			num_done += 1;
+		}
+		else if (command.IsEmpty ())
+		{
+			if (!(*_document_list)[i]->FinishExtraction (true))
+			{
+				to_remove.push_back ((*_document_list)[i]);
+			}
+			num_done += 1;
+		}
+		else
+		{
+			pool.Add (i, command);
+		}
+	}
+
+	// -- the dialog is updated, handling Cancel, while waiting on the converters
+	int id;
+	bool finished;
+	while (pool.Size () > 0)
+	{
+		if (!dialog.Update (num_done, "Please wait, processing file ..."))
 		{
 			if ( wxMessageBox ("Do you really want to cancel, and return to extracting files?",
 						"Cancelling the Progress Dialog",
 						wxYES_NO | wxICON_QUESTION) == wxYES )
 			{
+				pool.Cancel ();
 				return false; // abort the run
 			}
 			else
@@ -448,11 +499,16 @@ bool SelectFiles::ExtractFiles (int start_from)
 				dialog.Resume ();
 			}
 		}
-
-		if (!(*_document_list)[i]->ExtractDocument (extract_folder, i))
+		if (!pool.CheckNext (id, finished))
 		{
-			to_remove.push_back ((*_document_list)[i]);
+			wxMilliSleep (50);
+			continue;
+		}
+		if (!(*_document_list)[id]->FinishExtraction (finished))
+		{
+			to_remove.push_back ((*_document_list)[id]);
 		}
+		num_done += 1;
 	}
 
 	// remove unwanted or failed documents
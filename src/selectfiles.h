@@ -66,6 +66,7 @@ class SelectFiles: public wxFrame
 {
 	public:
 		SelectFiles ();
+		~SelectFiles ();
 	private:
 		void DownloadFiles ();
 		bool ExtractFiles (int start_from = 0);
@@ -83,7 +84,7 @@ class SelectFiles: public wxFrame
 		void WarnOfProblemFiles ();
 		void CreateComparisonView ();
 		void ReadDocuments (int start_from = 0);
-		DocumentList * _document_list;
+		DocumentList * _document_list; // -- passed on to the comparison view, when created
 		DECLARE_EVENT_TABLE()
   friend class DropFiles;
 };
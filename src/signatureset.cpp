@@ -0,0 +1,149 @@
+#include "signatureset.h"
+
+// -- the finalising steps of SplitMix64: a mixing of all 64 bits, which
+//    is one to one, so distinct inputs give distinct values
+wxUint64 SignatureSet::Mix (wxUint64 value)
+{
+	value = (value ^ (value >> 30)) * wxULL(0xBF58476D1CE4E5B9);
+	value = (value ^ (value >> 27)) * wxULL(0x94D049BB133111EB);
+	return value ^ (value >> 31);
+}
+
+static const wxUint64 STEP = wxULL(0x9E3779B97F4A7C15); // -- separates the hash functions
+static const int KEPT_BITS = 16;
+
+SignatureSet::SignatureSet (int num_hashes)
+	: _num_hashes (num_hashes < 0 ? 0 : num_hashes)
+{}
+
+void SignatureSet::SetNumHashes (int num_hashes)
+{
+	_num_hashes = (num_hashes < 0 ? 0 : num_hashes);
+	Clear ();
+}
+
+int SignatureSet::GetNumHashes () const
+{
+	return _num_hashes;
+}
+
+void SignatureSet::Clear ()
+{
+	_signatures.clear ();
+}
+
+wxUint64 SignatureSet::HashTrigram (std::size_t t0, std::size_t t1, std::size_t t2)
+{
+	return Mix (Mix (Mix (t0) ^ t1) ^ t2);
+}
+
+// hash function k is Mix (trigram + k * STEP), so each trigram is mixed once per hash
+void SignatureSet::SetSignature (int i, const std::vector<wxUint64> & trigrams)
+{
+	std::vector<wxUint64> least (_num_hashes, ~wxULL(0));
+	for (std::size_t t = 0, n = trigrams.size (); t < n; ++t)
+	{
+		wxUint64 value = trigrams[t];
+		for (int k = 0; k < _num_hashes; ++k)
+		{
+			value += STEP;
+			wxUint64 hash = Mix (value);
+			if (hash < least[k]) least[k] = hash;
+		}
+	}
+	if (_signatures.size () < (std::size_t)(i + 1) * _num_hashes)
+	{
+		_signatures.resize ((std::size_t)(i + 1) * _num_hashes, 0);
+	}
+	for (int k = 0; k < _num_hashes; ++k)
+	{
+		_signatures[(std::size_t)i * _num_hashes + k] = (wxUint16)(least[k] & ((1 << KEPT_BITS) - 1));
+	}
+}
+
+void SignatureSet::CopySignature (int original, int i)
+{
+	assert (original < i);
+	if (_signatures.size () < (std::size_t)(i + 1) * _num_hashes)
+	{
+		_signatures.resize ((std::size_t)(i + 1) * _num_hashes, 0);
+	}
+	std::copy (_signatures.begin () + (std::size_t)original * _num_hashes,
+			_signatures.begin () + (std::size_t)(original + 1) * _num_hashes,
+			_signatures.begin () + (std::size_t)i * _num_hashes);
+}
+
+void SignatureSet::RemoveSignature (int i)
+{
+	if (_signatures.size () < (std::size_t)(i + 1) * _num_hashes)
+	{
+		_signatures.resize (std::min (_signatures.size (), (std::size_t)i * _num_hashes));
+		return;
+	}
+	_signatures.erase (_signatures.begin () + (std::size_t)i * _num_hashes,
+			_signatures.begin () + (std::size_t)(i + 1) * _num_hashes);
+}
+
+// -- the fraction of agreeing values, less those agreeing by chance in
+//    the bits kept: if a fraction c of different values agree,
+//    p = R + (1-R)c, so R = (p - c) / (1 - c)
+float SignatureSet::EstimateResemblance (int i, int j) const
+{
+	if (_num_hashes == 0) return 0.0;
+	std::size_t needed = (std::size_t)(std::max (i, j) + 1) * _num_hashes;
+	if (_signatures.size () < needed) return 0.0; // -- not yet made
+	const wxUint16 * signature1 = &_signatures[(std::size_t)i * _num_hashes];
+	const wxUint16 * signature2 = &_signatures[(std::size_t)j * _num_hashes];
+	int agree = 0;
+	for (int k = 0; k < _num_hashes; ++k)
+	{
+		if (signature1[k] == signature2[k]) agree += 1;
+	}
+	double chance = 1.0 / (1 << KEPT_BITS);
+	double estimate = ((double)agree / _num_hashes - chance) / (1.0 - chance);
+	return (estimate < 0.0 ? 0.0 : (float)estimate);
+}
+
+// -- for each band, the documents are sorted by a hash of their values in the
+//    band, so documents agreeing on the band are next to each other
+// -- documents agreeing on every band form a pair for each band, so the pairs
+//    are sorted and the repeats removed
+void SignatureSet::FindCandidatePairs (int num_bands, const std::vector<int> & documents, std::vector<wxUint64> & pairs) const
+{
+	pairs.clear ();
+	if (num_bands < 1 || _num_hashes < num_bands) return;
+	int num_rows = _num_hashes / num_bands;
+	std::vector<std::pair<wxUint64, int> > keys;
+	for (int band = 0; band < num_bands; ++band)
+	{
+		keys.clear ();
+		for (int d = 0, n = documents.size (); d < n; ++d)
+		{
+			std::size_t start = (std::size_t)documents[d] * _num_hashes + band * num_rows;
+			if (start + num_rows > _signatures.size ()) continue; // -- no signature made
+			wxUint64 key = band;
+			for (int row = 0; row < num_rows; ++row)
+			{
+				key = Mix (key ^ _signatures[start + row]);
+			}
+			keys.push_back (std::make_pair (key, documents[d]));
+		}
+		std::sort (keys.begin (), keys.end ());
+		for (std::size_t first = 0, n = keys.size (); first < n; )
+		{
+			std::size_t last = first + 1;
+			while (last < n && keys[last].first == keys[first].first) last += 1;
+			for (std::size_t i = first; i < last; ++i)
+			{
+				for (std::size_t j = i + 1; j < last; ++j)
+				{
+					// -- keys with equal hashes are sorted by document
+					pairs.push_back (((wxUint64)keys[i].second << 32) + keys[j].second);
+				}
+			}
+			first = last;
+		}
+	}
+	std::sort (pairs.begin (), pairs.end ());
+	pairs.erase (std::unique (pairs.begin (), pairs.end ()), pairs.end ());
+}
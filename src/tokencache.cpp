@@ -0,0 +1,124 @@
+#include "tokencache.h"
+
+const wxUint32 TRIGRAMS_SECTION = MakeSectionTag ('T', 'R', 'I', 'G');
+
+TokenCache::TokenCache (wxString folder)
+	: _folder (folder),
+	  _hits (0),
+	  _misses (0)
+{
+	if (!wxFileName::DirExists (_folder))
+	{
+		wxFileName::Mkdir (_folder, 0777, wxPATH_MKDIR_FULL);
+	}
+}
+
+wxString TokenCache::GetFolder () const
+{
+	return _folder;
+}
+
+wxString TokenCache::GetEntryPath (wxUint64 hash, wxString reader) const
+{
+	wxString name = wxString::Format ("%08x%08x-", 
+			(unsigned int)(hash >> 32), (unsigned int)(hash & 0xFFFFFFFF));
+	return wxFileName (_folder, name + reader + ".ftc").GetFullPath ();
+}
+
+// -- the stored length of the file is checked as well as the hash
+bool TokenCache::Lookup (wxUint64 hash, wxUint64 length, wxString reader,
+		std::vector<wxString> & tokens, std::vector<wxUint32> & trigrams)
+{
+	wxMutexLocker lock (_mutex);
+	tokens.clear ();
+	trigrams.clear ();
+	wxFile file;
+	bool ok = wxFile::Exists (GetEntryPath (hash, reader)) && 
+		file.Open (GetEntryPath (hash, reader), wxFile::read);
+	if (ok)
+	{
+		BinaryReader input (file);
+		wxUint32 num_sections;
+		wxUint32 tag;
+		wxUint64 stored_length;
+		int num_tokens;
+		int num_trigrams;
+		ok = input.ReadHeader (num_sections) && 
+			input.BeginSection (tag) && 
+			tag == TRIGRAMS_SECTION &&
+			input.ReadVarint (stored_length) &&
+			stored_length == length &&
+			input.ReadVarint (num_tokens);
+		for (int i = 0; ok && i < num_tokens; ++i)
+		{
+			wxString token;
+			ok = input.ReadString (token);
+			tokens.push_back (token);
+		}
+		ok = ok && input.ReadVarint (num_trigrams);
+		for (int i = 0; ok && i < 3 * num_trigrams; ++i)
+		{
+			int token;
+			ok = input.ReadVarint (token) && token < num_tokens;
+			trigrams.push_back (token);
+		}
+		ok = ok && input.EndSection ();
+	}
+
+	if (ok)
+	{
+		_hits += 1;
+	}
+	else
+	{
+		tokens.clear ();
+		trigrams.clear ();
+		_misses += 1;
+	}
+	return ok;
+}
+
+bool TokenCache::Store (wxUint64 hash, wxUint64 length, wxString reader,
+		const std::vector<wxString> & tokens, const std::vector<wxUint32> & trigrams)
+{
+	wxMutexLocker lock (_mutex);
+	wxString path = GetEntryPath (hash, reader);
+	wxString temporary_path = path + wxString::Format (".%lu.tmp", wxGetProcessId ());
+	wxFile file;
+	if (!file.Open (temporary_path, wxFile::write)) return false;
+
+	BinaryWriter output (file);
+	output.WriteHeader (1);
+	output.BeginSection (TRIGRAMS_SECTION);
+	output.WriteVarint (length);
+	output.WriteVarint (tokens.size ());
+	for (std::size_t i = 0, n = tokens.size (); i < n; ++i)
+	{
+		output.WriteString (tokens[i]);
+	}
+	output.WriteVarint (trigrams.size () / 3);
+	for (std::size_t i = 0, n = trigrams.size (); i < n; ++i)
+	{
+		output.WriteVarint (trigrams[i]);
+	}
+	output.EndSection ();
+	bool ok = output.Flush ();
+	file.Close ();
+
+	if (!ok || !wxRenameFile (temporary_path, path, true))
+	{
+		wxRemoveFile (temporary_path);
+		return false;
+	}
+	return true;
+}
+
+int TokenCache::GetHits () const
+{
+	return _hits;
+}
+
+int TokenCache::GetMisses () const
+{
+	return _misses;
+}
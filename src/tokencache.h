@@ -0,0 +1,52 @@
+#if !defined tokencache_h
+#define tokencache_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <vector>
+#include <wx/wx.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/thread.h>
+
+#include "binaryio.h"
+#include "contenthash.h"
+
+/** TokenCache keeps the trigrams found in each file, so a file which is 
+  * unchanged since an earlier run need not be read and tokenised again.
+  * -- entries are keyed by the hash of the file's contents (see ContentHash)
+  *    and the name of the reader used to tokenise it, as the same file gives 
+  *    different tokens to different readers
+  * -- each entry is a file in the cache folder, holding the distinct trigrams 
+  *    of the document in the order first found, as indices into a list of the 
+  *    token strings; the number of trigrams is the document's trigram count
+  * -- entries are written to a temporary file and renamed, so a cache folder
+  *    can be shared by several runs
+  * -- counts of hits and misses are kept for reporting
+  * -- Lookup and Store may be called from different threads, e.g. by the
+  *    stages of an IngestPipeline, and are made one at a time
+  */
+class TokenCache
+{
+	public:
+		TokenCache (wxString folder);
+		wxString GetFolder () const;
+		// find the entry for a file's contents, returning false if there is none
+		bool Lookup (wxUint64 hash, wxUint64 length, wxString reader,
+				std::vector<wxString> & tokens, std::vector<wxUint32> & trigrams);
+		// store an entry, trigrams holding three indices into tokens for each trigram
+		bool Store (wxUint64 hash, wxUint64 length, wxString reader,
+				const std::vector<wxString> & tokens, const std::vector<wxUint32> & trigrams);
+		int GetHits () const;
+		int GetMisses () const;
+	private:
+		wxString GetEntryPath (wxUint64 hash, wxString reader) const;
+		wxString _folder;
+		wxMutex _mutex; // -- guards the folder's entries, and the counts
+		int _hits;
+		int _misses;
+};
+
+#endif
+
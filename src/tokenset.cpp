@@ -47,14 +47,20 @@ void Token::Grow ()
 // *** TokenSet
 
 TokenSet::TokenSet ()
-	: _nextindex (0)
+	: _nextindex (0), _base (NULL)
 {}
 
 std::size_t TokenSet::GetIndexFor (wxString token)
 {
 	_tokens_it = _tokens.find (token);
+	std::size_t index;
 	if (_tokens_it != _tokens.end())  // found it
 		return _tokens_it->second;
+	else if (_base != NULL && _base->FindToken (token, index)) // found in base, so remember it
+	{
+		_tokens[token] = index;
+		return index;
+	}
 	else // otherwise, make a new index
 	{
 		_tokens[token] = _nextindex;
@@ -66,6 +72,10 @@ std::size_t TokenSet::GetIndexFor (wxString token)
 
 wxString TokenSet::GetStringFor (std::size_t token)
 {
+	if (_base != NULL && token < _base->GetTokenCount ())
+	{
+		return _base->GetTokenString (token);
+	}
 	_strings_it = _strings.find (token);
 	assert (_strings_it != _strings.end ()); // it's an error if token not in token set
 	return wxString (_strings_it->second.c_str ());
@@ -76,16 +86,47 @@ void TokenSet::Clear ()
 	_tokens.clear ();
 	_strings.clear ();
 	_nextindex = 0;
+	_base = NULL;
+}
+
+// start again from the tokens in the given base
+void TokenSet::SetBase (const MappedIndex * base)
+{
+	Clear ();
+	_base = base;
+	_nextindex = base->GetTokenCount ();
+}
+
+std::size_t TokenSet::Size () const
+{
+	return _nextindex;
 }
 
 // save just one of the maps, as the other can be reconstructed (it's the inverse)
-void TokenSet::Save (wxFile & file)
+// -- tokens are written in index order, so the index itself need not be saved
+void TokenSet::Save (BinaryWriter & output, std::size_t first_token)
+{
+	assert (first_token <= _nextindex);
+	output.WriteVarint (_nextindex - first_token);
+	for (std::size_t i = first_token; i < _nextindex; ++i)
+	{
+		output.WriteString (GetStringFor (i));
+	}
+}
+
+bool TokenSet::Load (BinaryReader & input)
 {
-	file.Write (wxString::Format ("next-index\t%d\n", _nextindex));
-	for (std::size_t i = 0; i < _nextindex; ++i)
+	int num_tokens;
+	if (!input.ReadVarint (num_tokens)) return false;
+	for (int i = 0; i < num_tokens; ++i)
 	{
-		file.Write (wxString::Format ("%d\t%s\n", i, _strings[i].c_str ()));
+		wxString token;
+		if (!input.ReadString (token)) return false;
+		_strings.insert (_strings.end (), std::make_pair (_nextindex, token));
+		_tokens[token] = _nextindex;
+		_nextindex += 1;
 	}
+	return true;
 }
 
 void TokenSet::SetNextIndex (int index)
@@ -12,6 +12,9 @@
 #include <vector>
 #include <map>
 
+#include "binaryio.h"
+#include "mappedindex.h"
+
 /** A Token is a sequence of characters read in by a TokenReader
   * -- this class provides a dynamic storage for the token supporting
   *    addition of characters
@@ -37,6 +40,8 @@ class Token
   * -- this is for memory efficiency, ensuring every token's string is 
   *    stored once within the application 
   *   (this class could be removed if wxString had same property)
+  * -- a MappedIndex may be given as a base: its tokens keep their indices, 
+  *    and new tokens are numbered after them
   */
 class TokenSet
 {
@@ -45,8 +50,13 @@ class TokenSet
 		std::size_t GetIndexFor (wxString token);
 		wxString GetStringFor (std::size_t token);
 		void Clear ();
+		void SetBase (const MappedIndex * base);
+		std::size_t Size () const;
 		// methods to Save/Retrieve tokenset
-		void Save (wxFile & file);
+		// -- Save can write just the tokens from first_token, e.g. for a segment,
+		//    and Load adds the tokens read after any already held
+		void Save (BinaryWriter & output, std::size_t first_token = 0);
+		bool Load (BinaryReader & input);
 		void SetNextIndex (int index);
 		void SetIndexString (wxString token, int index);
 	private:
@@ -55,6 +65,7 @@ class TokenSet
 		std::size_t _nextindex; // next free index for new string
 		std::map<std::size_t, wxString> _strings;
 		std::map<std::size_t, wxString>::const_iterator _strings_it;
+		const MappedIndex * _base; // -- NULL if no base
 };
 
 #endif
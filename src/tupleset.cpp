@@ -1,11 +1,74 @@
 #include "tupleset.h"
 
+const std::size_t FROZEN_BLOCK = 16; // -- frozen tuples for each offset kept
+
+static void PutVarint (std::vector<wxUint8> & bytes, wxUint64 n)
+{
+	while (n >= 0x80)
+	{
+		bytes.push_back ((wxUint8)(n | 0x80));
+		n >>= 7;
+	}
+	bytes.push_back ((wxUint8)n);
+}
+
+static wxUint64 GetVarint (const std::vector<wxUint8> & bytes, std::size_t & offset)
+{
+	wxUint64 n = 0;
+	int shift = 0;
+	wxUint8 byte;
+	do
+	{
+		byte = bytes[offset++];
+		n |= ((wxUint64)(byte & 0x7F)) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	return n;
+}
+
+// compare two tuples, as in strcmp
+static int CompareKeys (const std::size_t key1[3], const std::size_t key2[3])
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		if (key1[i] < key2[i]) return -1;
+		if (key1[i] > key2[i]) return 1;
+	}
+	return 0;
+}
+
+// add the copies of the documents in fvector, sorting it if any are added
+static void AddCopiesTo (std::vector<int> & fvector, const std::map<int, std::vector<int> > & copies)
+{
+	bool copied = false;
+	for (int i = 0, n = fvector.size (); i < n; ++i)
+	{
+		std::map<int, std::vector<int> >::const_iterator it = copies.find (fvector[i]);
+		if (it == copies.end ()) continue;
+		fvector.insert (fvector.end (), it->second.begin (), it->second.end ());
+		copied = true;
+	}
+	if (copied) std::sort (fvector.begin (), fvector.end ());
+}
+
 TupleSet::TupleSet ()
+	: _base (NULL)
 {}
 
 void TupleSet::Clear ()
 {
 	_tuple_map.clear ();
+	_frozen_keys.clear ();
+	_frozen_postings.clear ();
+	_frozen_blocks.clear ();
+	_base = NULL;
+}
+
+// start again from the tuples in the given base
+void TupleSet::SetBase (const MappedIndex * base)
+{
+	Clear ();
+	_base = base;
 }
 
 int TupleSet::Size ()
@@ -21,53 +84,317 @@ int TupleSet::Size ()
 
 bool TupleSet::AddDocument (std::size_t token_0, std::size_t token_1, std::size_t token_2, int document, bool is_template)
 {
-	bool has_doc = false;
-  TupleDocs & tuple_docs = _tuple_map[token_0][token_1][token_2];
+	// check if document is already in the trigram in base
+	std::size_t tuple;
+	if (_base != NULL && _base->FindTuple (token_0, token_1, token_2, tuple))
+	{
+		for (int i = 0, n = _base->GetDocumentCount (tuple); i < n; ++i)
+		{
+			if (_base->GetDocument (tuple, i) == document) return false;
+		}
+	}
+	// -- or in the frozen tuples
+	if (FindFrozen (token_0, token_1, token_2, tuple))
+	{
+		std::size_t offset = GetFrozenOffset (tuple);
+		_found_docs.clear ();
+		ReadFrozen (offset, _found_docs);
+		if (std::find (_found_docs.begin (), _found_docs.end (), document) != _found_docs.end ()) return false;
+	}
+
+  PostingList & postings = _tuple_map[token_0][token_1][token_2];
   if (is_template) 
   {
-    tuple_docs.is_template_material = true;
+    postings.SetTemplate ();
   }
-	std::vector<int> & fvector = tuple_docs.docs;
 	// check if document is already in the trigram
-	for (int i = 0, n = fvector.size(); i < n; ++i)
+	if (!postings.HasDocument (document)) // didn't have document, so add it
 	{
-		if (fvector[i] == document)
+		postings.AddDocument (document);
+		return true;  // indicate that document added
+	}
+	return false;
+}
+
+// -- documents are added to tuples as they are read, in order, so the 
+//    documents of a tuple are sorted once its copies are added
+// -- documents are only added to the maps and frozen tuples, so copies are 
+//    only needed there: the frozen tuples are written again, with their copies
+void TupleSet::AddCopies (const std::map<int, std::vector<int> > & copies)
+{
+	for (TripMap::iterator ti = _tuple_map.begin (); ti != _tuple_map.end (); ++ti)
+	{
+		for (PairMap::iterator pi = ti->second.begin (); pi != ti->second.end (); ++pi)
 		{
-			has_doc = true;
-			break;
+			for (WordMap::iterator wi = pi->second.begin (); wi != pi->second.end (); ++wi)
+			{
+				PostingList & postings = wi->second;
+				bool copied = false;
+				for (int i = 0, n = postings.GetCount (); i < n; ++i)
+				{
+					std::map<int, std::vector<int> >::const_iterator it = copies.find (postings.GetDocument (i));
+					if (it == copies.end ()) continue;
+					for (int k = 0, m = it->second.size (); k < m; ++k) postings.AddDocument (it->second[k]);
+					copied = true;
+				}
+				if (copied) postings.Sort ();
+			}
 		}
 	}
 
-	if (!has_doc) // didn't have document, so add it
+	std::vector<wxUint32> keys;
+	std::vector<wxUint8> postings;
+	std::vector<std::size_t> blocks;
+	std::vector<int> docs;
+	std::size_t offset = 0;
+	for (std::size_t position = 0, n = GetFrozenCount (); position < n; ++position)
 	{
-		fvector.push_back (document);
-		return true;  // indicate that document added
+		std::size_t key[3];
+		for (int i = 0; i < 3; ++i) key[i] = _frozen_keys[3 * position + i];
+		docs.clear ();
+		bool is_template = ReadFrozen (offset, docs);
+		AddCopiesTo (docs, copies);
+		AppendFrozen (key, docs, is_template, keys, postings, blocks);
+	}
+	_frozen_postings.swap (postings);
+	_frozen_blocks.swap (blocks);
+}
+
+// Merge the tuples in the maps into the frozen tuples, writing new arrays
+// -- the maps of each first token are removed once their tuples are frozen,
+//    so the maps and the arrays are not held in full together
+// -- a tuple may be both frozen and in the maps, if documents were added 
+//    after the last Freeze: its documents are joined
+void TupleSet::Freeze ()
+{
+	if (_tuple_map.empty ()) return;
+	std::vector<wxUint32> keys;
+	std::vector<wxUint8> postings;
+	std::vector<std::size_t> blocks;
+	std::vector<int> docs;
+	std::size_t num_frozen = GetFrozenCount ();
+	std::size_t position = 0; // -- next frozen tuple, and offset of its documents
+	std::size_t offset = 0;
+	std::size_t frozen[3];
+	// -- make room for all the tuples at the start, as growing the arrays 
+	//    while the maps are held takes most memory: each document takes one
+	//    or two bytes, two unless the documents are few or close together
+	std::size_t num_tuples = num_frozen;
+	std::size_t num_bytes = _frozen_postings.size ();
+	for (TripMapIter ti = _tuple_map.begin (); ti != _tuple_map.end (); ++ti)
+	{
+		for (PairMapIter pi = ti->second.begin (); pi != ti->second.end (); ++pi)
+		{
+			for (WordMapIter wi = pi->second.begin (); wi != pi->second.end (); ++wi)
+			{
+				num_tuples += 1;
+				num_bytes += 1 + 2 * wi->second.GetCount ();
+			}
+		}
+	}
+	keys.reserve (3 * num_tuples);
+	postings.reserve (num_bytes);
+	blocks.reserve (num_tuples / FROZEN_BLOCK + 1);
+	while (!_tuple_map.empty ())
+	{
+		TripMap::iterator ti = _tuple_map.begin ();
+		for (PairMapIter pi = ti->second.begin (); pi != ti->second.end (); ++pi)
+		{
+			for (WordMapIter wi = pi->second.begin (); wi != pi->second.end (); ++wi)
+			{
+				std::size_t key[3] = {ti->first, pi->first, wi->first};
+				bool is_template = wi->second.IsTemplate ();
+				docs.clear ();
+				// -- copy across the frozen tuples up to this one
+				for ( ; position < num_frozen; ++position)
+				{
+					for (int i = 0; i < 3; ++i) frozen[i] = _frozen_keys[3 * position + i];
+					int cmp = CompareKeys (frozen, key);
+					if (cmp > 0) break;
+					bool was_template = ReadFrozen (offset, docs);
+					if (cmp == 0)
+					{
+						is_template = is_template || was_template;
+						position += 1;
+						break;
+					}
+					AppendFrozen (frozen, docs, was_template, keys, postings, blocks);
+					docs.clear ();
+				}
+				docs.insert (docs.end (), wi->second.GetDocuments (), wi->second.GetDocuments () + wi->second.GetCount ());
+				std::sort (docs.begin (), docs.end ());
+				AppendFrozen (key, docs, is_template, keys, postings, blocks);
+			}
+		}
+		_tuple_map.erase (ti);
+	}
+	for ( ; position < num_frozen; ++position)
+	{
+		for (int i = 0; i < 3; ++i) frozen[i] = _frozen_keys[3 * position + i];
+		docs.clear ();
+		bool is_template = ReadFrozen (offset, docs);
+		AppendFrozen (frozen, docs, is_template, keys, postings, blocks);
+	}
+	_frozen_keys.swap (keys);
+	_frozen_postings.swap (postings);
+	_frozen_blocks.swap (blocks);
+}
+
+// add a tuple, with its sorted documents, at the end of the given frozen arrays
+void TupleSet::AppendFrozen (const std::size_t key[3], const std::vector<int> & docs, bool is_template, 
+		std::vector<wxUint32> & keys, std::vector<wxUint8> & postings, std::vector<std::size_t> & blocks)
+{
+	if ((keys.size () / 3) % FROZEN_BLOCK == 0) blocks.push_back (postings.size ());
+	for (int i = 0; i < 3; ++i) keys.push_back (key[i]);
+	PutVarint (postings, 2 * (wxUint64)docs.size () + (is_template ? 1 : 0));
+	int last_doc = 0;
+	for (int i = 0, n = docs.size (); i < n; ++i)
+	{
+		PutVarint (postings, docs[i] - last_doc);
+		last_doc = docs[i];
+	}
+}
+
+std::size_t TupleSet::GetFrozenCount () const
+{
+	return _frozen_keys.size () / 3;
+}
+
+// binary search through the frozen tuples
+bool TupleSet::FindFrozen (std::size_t t0, std::size_t t1, std::size_t t2, std::size_t & tuple) const
+{
+	std::size_t key[3] = {t0, t1, t2};
+	std::size_t low = 0;
+	std::size_t high = GetFrozenCount ();
+	while (low < high)
+	{
+		std::size_t mid = low + (high - low) / 2;
+		std::size_t frozen[3];
+		for (int i = 0; i < 3; ++i) frozen[i] = _frozen_keys[3 * mid + i];
+		int cmp = CompareKeys (frozen, key);
+		if (cmp == 0)
+		{
+			tuple = mid;
+			return true;
+		}
+		else if (cmp < 0)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
 	}
 	return false;
 }
 
-bool TupleSet::IsMatchingTuple (std::size_t t0, std::size_t t1, std::size_t t2, int doc1, int doc2, bool unique, bool ignore)
+// offset of the documents of the given frozen tuple, from the start of its block
+std::size_t TupleSet::GetFrozenOffset (std::size_t tuple) const
 {
-  TupleDocs & tuple_docs = _tuple_map[t0][t1][t2];
-  if (ignore && tuple_docs.is_template_material) return false;
+	std::size_t offset = _frozen_blocks[tuple / FROZEN_BLOCK];
+	for (std::size_t skipped = tuple % FROZEN_BLOCK; skipped > 0; --skipped)
+	{
+		SkipFrozen (offset);
+	}
+	return offset;
+}
 
-	std::vector<int> & fvector = tuple_docs.docs;
-  if (unique && fvector.size () != 2) return false;
+// add the documents of the frozen tuple at offset to docs, moving offset past them
+// -- returns true if the tuple is in template material
+bool TupleSet::ReadFrozen (std::size_t & offset, std::vector<int> & docs) const
+{
+	wxUint64 header = GetVarint (_frozen_postings, offset);
+	int doc = 0;
+	for (wxUint64 i = header >> 1; i > 0; --i)
+	{
+		doc += (int)GetVarint (_frozen_postings, offset);
+		docs.push_back (doc);
+	}
+	return (header & 1) != 0;
+}
 
+void TupleSet::SkipFrozen (std::size_t & offset) const
+{
+	wxUint64 header = GetVarint (_frozen_postings, offset);
+	for (wxUint64 i = header >> 1; i > 0; --i)
+	{
+		while (_frozen_postings[offset++] & 0x80) {}
+	}
+}
+
+// find tuple in the maps, without adding it
+// -- returns NULL if not present
+const PostingList * TupleSet::FindTuple (std::size_t t0, std::size_t t1, std::size_t t2) const
+{
+	TripMapIter ti = _tuple_map.find (t0);
+	if (ti == _tuple_map.end ()) return NULL;
+	PairMapIter pi = ti->second.find (t1);
+	if (pi == ti->second.end ()) return NULL;
+	WordMapIter wi = pi->second.find (t2);
+	if (wi == pi->second.end ()) return NULL;
+	return &(wi->second);
+}
+
+bool TupleSet::IsMatchingTuple (std::size_t t0, std::size_t t1, std::size_t t2, int doc1, int doc2, bool unique, bool ignore)
+{
+	bool is_template = false;
+	int num_docs = 0;
 	bool has_doc1 = false;
 	bool has_doc2 = false;
-	for (int i=0, n=fvector.size(); i<n; ++i)
+
+	const PostingList * postings = FindTuple (t0, t1, t2);
+	if (postings != NULL)
 	{
-		if (fvector[i] == doc1) has_doc1 = true;
-		if (fvector[i] == doc2) has_doc2 = true;
+		is_template = postings->IsTemplate ();
+		num_docs += postings->GetCount ();
+		for (int i=0, n=postings->GetCount (); i<n; ++i)
+		{
+			if (postings->GetDocument (i) == doc1) has_doc1 = true;
+			if (postings->GetDocument (i) == doc2) has_doc2 = true;
+		}
+	}
+	std::size_t tuple;
+	if (FindFrozen (t0, t1, t2, tuple))
+	{
+		std::size_t offset = GetFrozenOffset (tuple);
+		_found_docs.clear ();
+		is_template = ReadFrozen (offset, _found_docs) || is_template;
+		num_docs += _found_docs.size ();
+		for (int i=0, n=_found_docs.size(); i<n; ++i)
+		{
+			if (_found_docs[i] == doc1) has_doc1 = true;
+			if (_found_docs[i] == doc2) has_doc2 = true;
+		}
+	}
+	if (_base != NULL && _base->FindTuple (t0, t1, t2, tuple))
+	{
+		is_template = is_template || _base->IsTemplateTuple (tuple);
+		num_docs += _base->GetDocumentCount (tuple);
+		for (int i=0, n=_base->GetDocumentCount (tuple); i<n; ++i)
+		{
+			int doc = _base->GetDocument (tuple, i);
+			if (doc == doc1) has_doc1 = true;
+			if (doc == doc2) has_doc2 = true;
+		}
 	}
+
+  if (ignore && is_template) return false;
+  if (unique && num_docs != 2) return false;
 	return ( has_doc1 && has_doc2 );
 }
 
 bool TupleSet::IsTemplateTuple (std::size_t t0, std::size_t t1, std::size_t t2) 
 {
-  TupleDocs & tuple_docs = _tuple_map[t0][t1][t2];
-  return tuple_docs.is_template_material;
+  const PostingList * postings = FindTuple (t0, t1, t2);
+  if (postings != NULL && postings->IsTemplate ()) return true;
+  std::size_t tuple;
+  if (FindFrozen (t0, t1, t2, tuple))
+  {
+    std::size_t offset = GetFrozenOffset (tuple);
+    if (GetVarint (_frozen_postings, offset) & 1) return true;
+  }
+  return (_base != NULL && _base->FindTuple (t0, t1, t2, tuple) && _base->IsTemplateTuple (tuple));
 }
 
 wxSortedArrayString TupleSet::CollectMatchingTuples (int doc1, int doc2, TokenSet & tokenset, bool unique, bool ignore)
@@ -84,14 +411,36 @@ wxSortedArrayString TupleSet::CollectMatchingTuples (int doc1, int doc2, TokenSe
 	return tuples; // note: wx library provides copy-on-write semantics
 }
 
+// The iterator moves through the maps, the frozen tuples and the base together, in 
+// order of tuple.  A tuple may be in more than one, if new documents have been added 
+// to a tuple from the base, or to a frozen tuple.
 void TupleSet::Begin ()
 {
 	_ti = _tuple_map.begin ();
-	_pi = (_ti->second).begin ();
-	_wi = (_pi->second).begin ();
+	if (_ti != _tuple_map.end ())
+	{
+		_pi = (_ti->second).begin ();
+		_wi = (_pi->second).begin ();
+	}
+	_base_position = 0;
+	_frozen_position = 0;
+	_frozen_offset = 0;
+	SetCurrentTuple ();
 }
 
 void TupleSet::GetNext ()
+{
+	if (_current_in_map) NextInMap ();
+	if (_current_in_frozen)
+	{
+		SkipFrozen (_frozen_offset);
+		_frozen_position += 1;
+	}
+	if (_current_in_base) _base_position += 1;
+	SetCurrentTuple ();
+}
+
+void TupleSet::NextInMap ()
 {
 	_wi++; // move to next word position
 	if (_wi == (_pi->second).end ())  // if words have finished, then move to next pair position
@@ -107,22 +456,90 @@ void TupleSet::GetNext ()
 	}
 }
 
+// current tuple is the smallest of the tuples at the map, frozen and base positions
+void TupleSet::SetCurrentTuple ()
+{
+	_current_in_map = (_ti != _tuple_map.end ());
+	_current_in_frozen = (_frozen_position < GetFrozenCount ());
+	_current_in_base = (_base != NULL && _base_position < _base->GetTupleCount ());
+	if (_current_in_map)
+	{
+		_current[0] = _ti->first;
+		_current[1] = _pi->first;
+		_current[2] = _wi->first;
+	}
+	if (_current_in_frozen)
+	{
+		std::size_t frozen_key[3];
+		for (int i = 0; i < 3; ++i) frozen_key[i] = _frozen_keys[3 * _frozen_position + i];
+		int cmp = (_current_in_map ? CompareKeys (frozen_key, _current) : -1);
+		if (cmp < 0)
+		{
+			_current_in_map = false;
+			for (int i = 0; i < 3; ++i) _current[i] = frozen_key[i];
+		}
+		else if (cmp > 0)
+		{
+			_current_in_frozen = false;
+		}
+	}
+	if (_current_in_base)
+	{
+		std::size_t base_key[3];
+		for (int i = 0; i < 3; ++i) base_key[i] = _base->GetToken (_base_position, i);
+		int cmp = (_current_in_map || _current_in_frozen ? CompareKeys (base_key, _current) : -1);
+		if (cmp < 0)
+		{
+			_current_in_map = false;
+			_current_in_frozen = false;
+			for (int i = 0; i < 3; ++i) _current[i] = base_key[i];
+		}
+		else if (cmp > 0)
+		{
+			_current_in_base = false;
+		}
+	}
+}
+
 bool TupleSet::HasMore () const
 {
-	return _ti != _tuple_map.end ();
+	return _current_in_map || _current_in_frozen || _current_in_base;
+}
+
+const std::vector<int> & TupleSet::GetDocumentsForCurrentTuple ()
+{
+	_current_docs.clear ();
+	if (_current_in_base)
+	{
+		_base->GetDocuments (_base_position, _current_docs);
+	}
+	if (_current_in_frozen)
+	{
+		std::size_t offset = _frozen_offset;
+		ReadFrozen (offset, _current_docs);
+	}
+	if (_current_in_map)
+	{
+		const PostingList & postings = _wi->second;
+		_current_docs.insert (_current_docs.end (), postings.GetDocuments (), postings.GetDocuments () + postings.GetCount ());
+	}
+	return _current_docs;
 }
 
-std::vector<int> & TupleSet::GetDocumentsForCurrentTuple ()
+bool TupleSet::IsTemplateForCurrentTuple () const
 {
-	return _tuple_map[_ti->first][_pi->first][_wi->first].docs;
+	std::size_t offset = _frozen_offset;
+	return (_current_in_map && _wi->second.IsTemplate ()) ||
+		(_current_in_frozen && (GetVarint (_frozen_postings, offset) & 1) != 0) ||
+		(_current_in_base && _base->IsTemplateTuple (_base_position));
 }
 
 wxString TupleSet::GetStringForCurrentTuple (TokenSet & tokenset) const
 {
 	wxString tuple = "";
-	tuple += tokenset.GetStringFor (_ti->first);
-	tuple += " " + tokenset.GetStringFor (_pi->first);
-	tuple += " " + tokenset.GetStringFor (_wi->first);
+	tuple += tokenset.GetStringFor (_current[0]);
+	tuple += " " + tokenset.GetStringFor (_current[1]);
+	tuple += " " + tokenset.GetStringFor (_current[2]);
 	
 	return tuple;
 
@@ -131,26 +548,112 @@ wxString TupleSet::GetStringForCurrentTuple (TokenSet & tokenset) const
 std::size_t TupleSet::GetToken (int i) const
 {
 	assert (i>=0 && i<=2);
-	if (i == 0)
-		return _ti->first;
-	else if (i == 1)
-		return _pi->first;
-	else // if (i == 2)
-		return _wi->first;
+	return _current[i];
 }
 
-void TupleSet::Save (wxFile & file)
+// Tuples are written in sorted order, so each token is written as the difference 
+// from the previous tuple's token, unless an earlier token in the tuple changed.
+// Each tuple's documents are sorted, and also written as differences.
+// -- when first_document is given, only tuples found in documents from 
+//    first_document onwards are written, listing just those documents
+void TupleSet::Save (BinaryWriter & output, int first_document)
 {
+	std::vector<int> indices;
+	std::size_t num_tuples = 0;
+	if (first_document == 0)
+	{
+		num_tuples = Size ();
+	}
+	else
+	{
+		for (Begin (); HasMore (); GetNext ())
+		{
+			indices = GetDocumentsForCurrentTuple ();
+			if (*std::max_element (indices.begin (), indices.end ()) >= first_document)
+			{
+				num_tuples += 1;
+			}
+		}
+	}
+	output.WriteVarint (num_tuples);
+
+	std::size_t last[3] = {0, 0, 0};
+	bool first = true;
 	for (Begin (); HasMore (); GetNext ())
 	{
-		const std::vector<int> indices = GetDocumentsForCurrentTuple ();
-		file.Write (wxString::Format ("%d %d %d", 
-					GetToken (0), GetToken (1), GetToken (2)));
-		file.Write (" FILES:[ ");
-		for (int i = 0, n = indices.size (); i < n; ++i)
+		indices = GetDocumentsForCurrentTuple ();
+		std::sort (indices.begin (), indices.end ());
+		std::vector<int>::iterator start = std::lower_bound (indices.begin (), indices.end (), first_document);
+		if (start == indices.end ()) continue; // -- no documents to write
+
+		std::size_t t0 = GetToken (0);
+		std::size_t t1 = GetToken (1);
+		std::size_t t2 = GetToken (2);
+		bool new_t0 = first || t0 != last[0];
+		bool new_t1 = new_t0 || t1 != last[1];
+		output.WriteVarint (t0 - last[0]);
+		output.WriteVarint (new_t0 ? t1 : t1 - last[1]);
+		output.WriteVarint (new_t1 ? t2 : t2 - last[2]);
+		last[0] = t0; last[1] = t1; last[2] = t2;
+		first = false;
+
+		output.WriteByte (IsTemplateForCurrentTuple () ? 1 : 0);
+		output.WriteVarint (indices.end () - start);
+		int last_doc = 0;
+		for (std::vector<int>::iterator it = start; it != indices.end (); ++it)
+		{
+			output.WriteVarint (*it - last_doc);
+			last_doc = *it;
+		}
+	}
+}
+
+// Read tuples written by Save.  As these arrive in sorted order, 
+// each is added at the end of its map.
+// -- tuples already held, e.g. from an earlier segment, have the documents added;
+//    these must follow any documents already listed for the tuple
+bool TupleSet::Load (BinaryReader & input)
+{
+	wxUint64 num_tuples;
+	if (!input.ReadVarint (num_tuples)) return false;
+	std::size_t last[3] = {0, 0, 0};
+	bool first = true;
+	TripMap::iterator ti = _tuple_map.end ();
+	PairMap::iterator pi;
+	for (wxUint64 k = 0; k < num_tuples; ++k)
+	{
+		wxUint64 d0, d1, d2;
+		if (!input.ReadVarint (d0) || !input.ReadVarint (d1) || !input.ReadVarint (d2)) return false;
+		bool new_t0 = first || d0 != 0;
+		std::size_t t0 = last[0] + d0;
+		std::size_t t1 = (new_t0 ? d1 : last[1] + d1);
+		bool new_t1 = new_t0 || t1 != last[1];
+		std::size_t t2 = (new_t1 ? d2 : last[2] + d2);
+		last[0] = t0; last[1] = t1; last[2] = t2;
+		first = false;
+
+		if (new_t0)
+		{
+			ti = _tuple_map.insert (_tuple_map.end (), std::make_pair (t0, PairMap ()));
+		}
+		if (new_t1)
+		{
+			pi = ti->second.insert (ti->second.end (), std::make_pair (t1, WordMap ()));
+		}
+		PostingList & postings = pi->second.insert (pi->second.end (), std::make_pair (t2, PostingList ()))->second;
+
+		wxUint8 flags;
+		int num_docs;
+		if (!input.ReadByte (flags) || !input.ReadVarint (num_docs)) return false;
+		if (flags & 1) postings.SetTemplate ();
+		int doc = 0;
+		for (int i = 0; i < num_docs; ++i)
 		{
-			file.Write (wxString::Format ("%d ", indices[i]));
+			int delta;
+			if (!input.ReadVarint (delta)) return false;
+			doc += delta;
+			postings.AddDocument (doc);
 		}
-		file.Write ("] \n");
 	}
+	return true;
 }
@@ -9,22 +9,18 @@
 #include <assert.h>
 #include <wx/wx.h>
 #include <wx/file.h>
+#include <algorithm>
 #include <map>
 #include <vector>
 
+#include "binaryio.h"
+#include "mappedindex.h"
+#include "postinglist.h"
 #include "tokenset.h"
 
-/* Class to hold fvector and flag for documents per tuple */
-class TupleDocs
-{
-  public:
-    std::vector<int> docs;
-    bool is_template_material;
-};
-
 /** TupleSet maintains the database mapping trigrams to identifier of documents which contain them.
   * The mapping is held as a sequence of std::maps, each map taking a std::size_t reference to 
-  * a token as a key.  The end result of the three maps is a vector of document identifiers.
+  * a token as a key.  The end result of the three maps is a PostingList of document identifiers.
   *
   * The most important feature of the TupleSet is the collection of methods for iterating over 
   * all tuples in the TupleSet.
@@ -33,12 +29,24 @@ class TupleDocs
   *                            {}
   * to iterate over all the tuples.  The methods: GetDocumentsForCurrentTuple, GetStringForCurrentTuple,
   * and GetToken0, GetToken1, GetToken2 return information on the current tuple.
+  *
+  * A MappedIndex may be given as a read-only base.  New tuples and documents are 
+  * added to the maps, and the iterator and queries combine the base with the maps.
+  *
+  * Freeze moves the tuples in the maps into compact, sorted arrays, before the
+  * tuples are compared: the tokens of each tuple as three u32, and its documents
+  * as varints -- the number of documents, times two, plus one for template 
+  * material, then the first document and the differences between the rest.
+  * -- a map entry takes some 64 bytes for a tuple of one or two documents, the
+  *    frozen arrays 14 or so, and the arrays are read in order by the iterator
+  * -- the frozen tuples are read like the base: documents added later go to 
+  *    the maps, and are merged into the arrays by the next Freeze
   */
 class TupleSet
 {
  
 	// typedef's to simplify declarations
-	typedef std::map<std::size_t, TupleDocs> WordMap;
+	typedef std::map<std::size_t, PostingList> WordMap;
 	typedef WordMap::const_iterator WordMapIter;
 
 	typedef std::map<std::size_t, WordMap> PairMap;
@@ -50,35 +58,68 @@ class TupleSet
 	public:
 		TupleSet ();
 		void Clear ();
+		void SetBase (const MappedIndex * base);
 		int Size ();
 		// given a tuple and a document identifier, 
 		// - make sure that the document is in the list for that tuple
 		// - returns true if the document was not already in trigram's list
 		bool AddDocument (std::size_t token_0, std::size_t token_1, std::size_t token_2, 
 				int document, bool is_template);
+		// move the tuples in the maps into the frozen arrays
+		void Freeze ();
+		// add the copies of each document to every tuple holding the document
+		// -- copies maps a document to its copies, which are not template material
+		void AddCopies (const std::map<int, std::vector<int> > & copies);
 		// check if two documents share the given tuple
 		bool IsMatchingTuple (std::size_t t0, std::size_t t1, std::size_t t2, int doc1, int doc2, bool unique = false, bool ignore = false);
 		bool IsTemplateTuple (std::size_t t0, std::size_t t1, std::size_t t2);
 		// collect and return all tuples in the two given documents
 		wxSortedArrayString CollectMatchingTuples (int doc1, int doc2, TokenSet & tokenset, bool unique = false, bool ignore = false);
 	private:
+		const PostingList * FindTuple (std::size_t t0, std::size_t t1, std::size_t t2) const;
+		std::size_t GetFrozenCount () const;
+		bool FindFrozen (std::size_t t0, std::size_t t1, std::size_t t2, std::size_t & tuple) const;
+		std::size_t GetFrozenOffset (std::size_t tuple) const;
+		bool ReadFrozen (std::size_t & offset, std::vector<int> & docs) const;
+		void SkipFrozen (std::size_t & offset) const;
+		static void AppendFrozen (const std::size_t key[3], const std::vector<int> & docs, bool is_template, 
+				std::vector<wxUint32> & keys, std::vector<wxUint8> & postings, std::vector<std::size_t> & blocks);
 		TripMap	_tuple_map;
+		const MappedIndex * _base; // -- NULL if no base
+		std::vector<wxUint32>	_frozen_keys;     // -- three tokens for each frozen tuple, sorted
+		std::vector<wxUint8>	_frozen_postings; // -- documents of each frozen tuple, in order
+		std::vector<std::size_t>	_frozen_blocks;   // -- offset in _frozen_postings of every 16th tuple
+		std::vector<int>	_found_docs;      // -- documents of a frozen tuple, when queried
 	public: // following methods and data structures are to handle an iterator on tupleset
 		void Begin ();			// start the iterator
 		void GetNext ();		// advance the iterator
 		bool HasMore () const;		// check for end
 		// retrieve current tuple's documents
-		std::vector<int> & GetDocumentsForCurrentTuple ();	
+		const std::vector<int> & GetDocumentsForCurrentTuple ();	
+		bool IsTemplateForCurrentTuple () const;
 		// retrieve string for current tuple
 		wxString GetStringForCurrentTuple (TokenSet & tokenset) const;	
 		// retrieve identifiers for individual tokens
 		std::size_t GetToken (int i) const;
 		// methods to save/retrieve tuples
-		void Save (wxFile & file);
+		// -- Save can write just the documents from first_document, e.g. for a segment,
+		//    and Load adds the documents read to any tuples already held
+		void Save (BinaryWriter & output, int first_document = 0);
+		bool Load (BinaryReader & input);
 	private:
+		void NextInMap ();
+		void SetCurrentTuple ();
 		TripMapIter	_ti;	// iterator from first token to pairs
 		PairMapIter	_pi;	// iterator from second token to words
 		WordMapIter	_wi;	// iterator from third token to document list
+		std::size_t	_base_position;	// iterator through tuples of base
+		std::size_t	_frozen_position;	// iterator through frozen tuples
+		std::size_t	_frozen_offset;	// -- and the offset of its documents
+		std::size_t	_current[3];	// tokens of current tuple
+		bool		_current_in_map;
+		bool		_current_in_frozen;
+		bool		_current_in_base;
+		std::vector<int> _current_docs; // documents of current tuple
 };
 
 #endif
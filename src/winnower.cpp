@@ -0,0 +1,64 @@
+#include "winnower.h"
+
+Winnower::Winnower (int window)
+	: _window (window < 1 ? 1 : window),
+	  _entries (window < 1 ? 1 : window),
+	  _count (0),
+	  _kept (-1)
+{}
+
+wxUint64 Winnower::HashTrigram (wxUint64 hash0, wxUint64 hash1, wxUint64 hash2)
+{
+	return SignatureSet::Mix (SignatureSet::Mix (SignatureSet::Mix (hash0) ^ hash1) ^ hash2);
+}
+
+// -- the window ends at the trigram just added: its least hash is the one
+//    kept before, unless that has left the window or the new hash is smaller,
+//    so on a tie the fingerprint already kept stays
+bool Winnower::Add (wxUint64 hash, std::size_t t0, std::size_t t1, std::size_t t2)
+{
+	Entry & entry = _entries[_count % _window];
+	entry.hash = hash;
+	entry.tokens[0] = t0;
+	entry.tokens[1] = t1;
+	entry.tokens[2] = t2;
+	_count += 1;
+	if (_count < _window) return false; // -- no whole window yet
+
+	if (_kept < 0 || _kept <= _count - 1 - _window)
+	{
+		KeepLeast ();
+		return true;
+	}
+	if (entry.hash < _entries[_kept % _window].hash)
+	{
+		_kept = _count - 1;
+		return true;
+	}
+	return false;
+}
+
+bool Winnower::Finish ()
+{
+	if (_count == 0 || _count >= _window) return false;
+	KeepLeast ();
+	return true;
+}
+
+std::size_t Winnower::GetToken (int i) const
+{
+	return _entries[_kept % _window].tokens[i];
+}
+
+// keep the rightmost least hash in the window, or among all trigrams if fewer
+// -- used only when no fingerprint already kept is in the window
+void Winnower::KeepLeast ()
+{
+	long first = (_count > _window ? _count - _window : 0);
+	_kept = first;
+	for (long position = first + 1; position < _count; ++position)
+	{
+		if (_entries[position % _window].hash <= _entries[_kept % _window].hash) _kept = position;
+	}
+}
+
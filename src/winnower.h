@@ -0,0 +1,53 @@
+#if !defined winnower_h
+#define winnower_h
+
+/** (c) School of Computer Science, University of Hertfordshire
+  */
+
+#include <vector>
+#include <wx/wx.h>
+#include "signatureset.h"
+
+/** Winnower picks fingerprints from the sequence of trigrams of a document,
+  * as in MOSS: each trigram is hashed, and in every window of w consecutive
+  * trigrams the one with the least hash is kept, so only about 2/(w+1) of
+  * the trigrams are kept.
+  * -- ties are settled by robust winnowing: a fingerprint already kept stays
+  *    while it is in the window, and otherwise the rightmost least is kept,
+  *    so runs of equal hashes, e.g. repeated text, give few fingerprints
+  * -- any run of at least w+2 tokens shared by two documents gives them a
+  *    fingerprint in common, as both keep the least hash of the first window
+  *    within the run
+  * -- each trigram's hash is made from hashes of its tokens' text, given by
+  *    the caller, so the same text gives the same fingerprints whatever the 
+  *    numbering of the tokens, e.g. in a later run
+  * -- a document with fewer than w trigrams keeps the least of them
+  * Use: for each trigram read, call Add, and if it returns true, take the
+  * fingerprint's tokens with GetToken; at the end, call Finish likewise.
+  */
+class Winnower
+{
+	public:
+		Winnower (int window);
+		// the hash of a trigram, from the hashes of its three tokens
+		static wxUint64 HashTrigram (wxUint64 hash0, wxUint64 hash1, wxUint64 hash2);
+		// add the next trigram, with its hash, returning true if a fingerprint is kept
+		bool Add (wxUint64 hash, std::size_t t0, std::size_t t1, std::size_t t2);
+		// returns true if a fingerprint is kept from a document shorter than the window
+		bool Finish ();
+		std::size_t GetToken (int i) const; // -- of the fingerprint last kept, 0 <= i < 3
+	private:
+		struct Entry
+		{
+			wxUint64 hash;
+			std::size_t tokens[3];
+		};
+		void KeepLeast ();
+		int		_window;
+		std::vector<Entry>	_entries; // -- the last _window trigrams, indexed by position % _window
+		long	_count;                // -- trigrams added
+		long	_kept;                 // -- position of the fingerprint last kept, or -1
+};
+
+#endif
+